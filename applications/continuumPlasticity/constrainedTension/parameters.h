@@ -56,6 +56,26 @@
  *Specify how frequently to write output files (i.e. output every n steps; using 0 or 1 will output every step)
  */
 #define skipOutputSteps 50
+/**
+ *Output file type: "pvtu" (one vtu file per MPI process and a pvtu record), "vtu" (one vtu file per increment written collectively with MPI-IO) or "hdf5" (one hdf5 file per increment and an xdmf record, requires deal.II with HDF5)
+ */
+#define outputFileType "pvtu"
+/**
+ *Write a checkpoint (mesh, displacements, history and load state in outputDirectory) every n increments (0: no checkpoints)
+ */
+#define checkpointInterval 0
+/**
+ *Flag to restart from the last checkpoint in outputDirectory (same coarse mesh, the refined mesh is restored from the checkpoint)
+ */
+#define restartFromCheckpoint false
+/**
+ *Repartition the mesh by the measured constitutive cost of the elements every n increments (0: no load balancing)
+ */
+#define loadBalanceInterval 0
+/**
+ *Ratio of the maximum to the mean assembly time per MPI process above which the mesh is repartitioned
+ */
+#define loadImbalanceTolerance 1.1
 /**
  *Flag to output the equivalent plastic strain field
  */
@@ -76,6 +96,10 @@
  *Solve type for linear solves
  */
 #define linearSolverType PETScWrappers::SolverCG
+/**
+ *Preconditioner of the linear solver ("jacobi", "blockJacobi", "sor", "ssor" or "boomerAMG"; "blockJacobi" and "sor" are not symmetric and need GMRES or BiCGStab)
+ */
+#define preconditionerType "jacobi"
 /**
  *Number of increments (i.e. loads steps, pseudo-time steps)
  */
@@ -21,6 +21,14 @@
 #define writeOutput true // flag to write output vtu and pvtu files
 #define outputDirectory "."
 #define skipOutputSteps 0
+#define outputFileType "pvtu" // "pvtu": one vtu file per MPI process and a pvtu record, "vtu": one vtu file per increment written collectively (MPI-IO), "hdf5": one hdf5 file per increment and an xdmf record (requires deal.II with HDF5)
+#define orientationsOutputFormat "binary" // "binary": orientationsOutput.bin, uint64 number of rows and columns followed by the rows as float64, "text": orientationsOutput, %8.2e text
+#define orientationsOutputStride 1 // write the orientations every n increments (and after the last increment)
+#define checkpointInterval 0 // Write a checkpoint (mesh, displacements, history and load state in outputDirectory) every n increments (0: no checkpoints)
+#define restartFromCheckpoint false // Flag to restart from the last checkpoint in outputDirectory (same coarse mesh, the refined mesh is restored from the checkpoint)
+#define loadBalanceInterval 0 // Repartition the mesh by the measured constitutive cost of the cells every n increments, if the assembly time of the slowest MPI process exceeds the mean by more than loadImbalanceTolerance (0: no load balancing)
+#define loadImbalanceTolerance 1.1 // Ratio of the maximum to the mean assembly time per MPI process above which the mesh is repartitioned
+#define projectionType "l2" // Projection of the post-processed fields ("l2": consistent mass matrix solve, "lumped": lumped mass matrix, no solve)
 #define output_Eqv_strain true
 #define output_Eqv_stress true
 #define output_Grain_ID   true
@@ -28,13 +36,29 @@
 
 /*Solver parameters*/
 #define linearSolverType PETScWrappers::SolverCG // Type of linear solver
+#define preconditionerType "jacobi" // Preconditioner of the linear solver ("jacobi", "blockJacobi", "sor", "ssor" or "boomerAMG"; "blockJacobi" and "sor" are not symmetric and need GMRES or BiCGStab; "jacobi" or "chebyshev" with the matrix-free tangent)
 #define totalNumIncrements 100 // No. of increments
 #define maxLinearSolverIterations 50000 // Maximum iterations for linear solver
 #define relLinearSolverTolerance  1.0e-10 // Relative linear solver tolerance
+#define reusePreconditioner false // Flag to keep the preconditioner across nonlinear iterations and increments
+#define preconditionerRebuildIterations 1000 // Rebuild a reused preconditioner once a linear solve needs more iterations
+#define warmStartLinearSolver false // Flag to start each increment's first linear solve from the previous increment's solution increment
+#define enableInexactNewton false // Flag to set the linear solver tolerance by Eisenstat-Walker forcing terms (inexact Newton)
+#define maxForcingTerm 0.1 // Largest relative linear solver tolerance with inexact Newton
+#define enableMatrixFreeTangent false // Flag to store the tangents dP/dF of the quadrature points and apply the jacobian cell by cell instead of assembling the global jacobian and its sparsity pattern (linearSolverType and multithreaded assembly are honored). Does not reduce memory: with Q1 elements the double precision tangents take about 1.8 times the memory of the assembled jacobian
+#define matrixFreeTangentSinglePrecision false // Flag to store the matrix-free tangents in single precision (half the memory, inexact Newton jacobian)
+#define matrixFreeChebyshevDegree 4 // Degree of the Chebyshev smoother (preconditionerType "chebyshev") with the matrix-free tangent
+#define blockedStiffnessKernel true // Flag to build the elemental residual and stiffness with the blocked kernel, vectorized over quadrature points (false: reference scalar loops)
+#define enableSelectiveReevaluation false // Flag to reuse the stress and tangent of quadrature points whose deformation gradient has not changed measurably since their last update (from the second nonlinear iteration of an increment)
+#define reevaluationToleranceFactor 0.01 // Tolerance of the selective re-evaluation relative to relNonLinearTolerance
 #define maxNonLinearIterations 4 // Maximum no. of non-linear iterations
 #define absNonLinearTolerance 1.0e-18 // Non-linear solver tolerance
 #define relNonLinearTolerance 1.0e-3 // Relative non-linear solver tolerance
 #define stopOnConvergenceFailure false // Flag to stop problem if convergence fails
+#define enableMultithreadedAssembly false // Flag to assemble with multiple threads per MPI process
+//#define numAssemblyThreads 4 // No. of assembly threads per MPI process (default: no. of cores)
+#define assemblyScatterType "copier" // Scatter of elemental values in multithreaded assembly ("copier", "mutex", "colored" or "private")
+#define benchmarkAssemblyScatter false // Flag to time the assembly with each scatter type before the first increment
 
 /*Adaptive time-stepping parameters*/
 #define enableAdaptiveTimeStepping false //Flag to enable adaptive time steps
@@ -131,6 +155,7 @@ double saturationStressTwin[numTwinSystems]= {50.0, 50.0, 50.0, 50.0, 50.0, 50.0
 unsigned int numPts[3]={20, 20, 22}; // No. of voxels in x,y and z directions
 #define grainIDFile "grainID.txt" // Grain ID File
 #define headerLinesGrainIDFile 5 // No. of header Lines
+#define convertGrainIDFile false // write the grain IDs of a text grainIDFile to grainIDFile.bin (binary, memory mapped when given as grainIDFile in the following runs)
 #define grainOrientationsFile "orientations.txt" // Slip Normals File
 
 
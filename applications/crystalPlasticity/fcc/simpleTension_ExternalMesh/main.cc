@@ -17,19 +17,20 @@ using namespace std;
 //overload mesh() method to generate the required polycrystal geometry
 template <int dim>
 void crystalPlasticity<dim>::mesh(){
-  //reading external mesh
-  this->pcout << "reading problem mesh\n";
-  GridIn<dim> gridin;
-  gridin.attach_triangulation(this->triangulation);
-  //Read mesh in UCD format generated from Cubit
-  std::ifstream f("n10-id2_hex.msh");
-  gridin.read_msh(f);
+  //reading external mesh (processor 0 reads the file and broadcasts the coarse mesh)
+  this->readExternalMesh(externalMeshFile);
 
   //Output image for viewing
-  std::ofstream out ("mesh.vtk");
-  GridOut grid_out;
-  grid_out.write_vtk (this->triangulation, out);
-  this->pcout << "writing mesh image to mesh.vtk\n";
+#ifdef  writeMeshToEPS
+#if writeMeshToEPS==true
+  if ((this->triangulation.n_global_active_cells()<10000) && (Utilities::MPI::this_mpi_process(this->mpi_communicator)==0)){
+    std::ofstream out ("mesh.vtk");
+    GridOut grid_out;
+    grid_out.write_vtk (this->triangulation, out);
+    this->pcout << "writing mesh image to mesh.vtk\n";
+  }
+#endif
+#endif
 } 
 #endif
 #endif
@@ -72,6 +72,10 @@
 *Solve type for linear solves
  */
 #define linearSolverType PETScWrappers::SolverCG
+/**
+ *Preconditioner of the linear solver ("jacobi", "blockJacobi", "sor", "ssor" or "boomerAMG"; "blockJacobi" and "sor" are not symmetric and need GMRES or BiCGStab)
+ */
+#define preconditionerType "jacobi"
 /**
  *Number of increments (i.e. loads steps, pseudo-time steps)
  */
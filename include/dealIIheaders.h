@@ -43,5 +43,19 @@
 #include <deal.II/lac/petsc_precondition.h>
 #include <deal.II/lac/solver_cg.h>
 #include <deal.II/lac/solver_gmres.h>
+#include <deal.II/lac/solver_bicgstab.h>
+#include <deal.II/lac/solver_minres.h>
+#include <deal.II/lac/precondition.h>
 #include <deal.II/distributed/tria.h>
 #include <deal.II/distributed/grid_refinement.h>
+#include <deal.II/distributed/solution_transfer.h>
+#include <deal.II/base/work_stream.h>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/serialization/vector.hpp>
+#include <deal.II/base/multithread_info.h>
+#include <deal.II/base/thread_management.h>
+#include <deal.II/base/thread_local_storage.h>
+#include <deal.II/grid/filtered_iterator.h>
+#include <deal.II/base/aligned_vector.h>
+#include <deal.II/base/vectorization.h>
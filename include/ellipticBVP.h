@@ -5,6 +5,7 @@
 //general headers
 #include <fstream>
 #include <sstream>
+#include <cstring>
 
 //dealii headers
 #include "dealIIheaders.h"
@@ -22,6 +23,11 @@ typedef PETScWrappers::MPI::SparseMatrix matrixType;
 //LA::MPI::SparseMatrix
 //LA::MPI::Vector
 
+//utility objects
+#include "../src/utilityObjects/assemblyBuffer.cc"
+#include "../src/utilityObjects/checkpointIO.cc"
+#include "../src/utilityObjects/cellDataTransfer.cc"
+
 //
 //base class for elliptic PDE's
 //
@@ -52,15 +58,88 @@ class ellipticBVP
   
   //methods
   virtual void mesh();
+  //import of an external coarse mesh (gmsh or binary mesh file, see externalMesh.cc)
+  void readExternalMesh(const std::string& fileName);
   void init();
+  //distribute the dofs and allocate the global data structures (see init.cc)
+  void setupSystem();
   void assemble();
   void solveLinearSystem(ConstraintMatrix& constraintmatrix, matrixType& A, vectorType& b, vectorType& x, vectorType& xGhosts, vectorType& dxGhosts);
   void solveLinearSystem2(ConstraintMatrix& constraintmatrix, matrixType& A, vectorType& b, vectorType& x, vectorType& xGhosts, vectorType& dxGhosts);
+  //preconditioner of the jacobian ("jacobi", "blockJacobi", "sor", "ssor" or "boomerAMG", see preconditioner.cc)
+  void buildPreconditioner(matrixType& A);
+  void setRigidBodyModes(matrixType& A);
+  std::string linearPreconditioner;
+  std_cxx11::shared_ptr<PETScWrappers::PreconditionerBase> jacobianPreconditioner;
+  unsigned int jacobianPreconditionerIncrement;
+  //linear solver statistics, reported at the end of the solve
+  unsigned int numLinearSolves, numLinearIterations, numPreconditionerSetups;
+  //set when a linear solve needed more than preconditionerRebuildIterations iterations
+  bool rebuildPreconditioner;
+  //relative tolerance of the next jacobian solve (fixed, or the inexact Newton forcing term)
+  double linearSolverRelTolerance;
+  //converged displacement increment and load factor of the previous increment (warm start)
+  vectorType previousIncrementSolution;
+  double previousIncrementLoadFactor;
+
+  //matrix-free tangent: the tangents dP/dF of the quadrature points are stored and the action
+  //of the jacobian is computed cell by cell instead of assembling the global jacobian (see
+  //matrixFreeTangent.cc)
+  bool matrixFreeTangent, matrixFreeSinglePrecision;
+  void initMatrixFreeTangent();
+  void storeQuadPointTangent(const unsigned int cellID, const unsigned int q, const FullMatrix<double>& dP_dF, const double JxW);
+  void storeElementalTangent(const FullMatrix<double>& elementalJacobian, const Vector<double>& elementalResidual, const std::vector<types::global_dof_index>& local_dof_indices);
+  void finalizeMatrixFreeTangent();
+  void applyTangent(vectorType& dst, const vectorType& src) const;
+  void solveMatrixFree(vectorType& x, const vectorType& b, SolverControl& solver_control);
+  std::vector<double> quadPointTangents;
+  std::vector<float> quadPointTangentsSingle;
+  std::vector<types::global_dof_index> constrainedOwnedDofs;
+  vectorType inverseTangentDiagonal;
+  mutable vectorType tangentSrcGhosts;
+  //operator and Jacobi preconditioner handed to the Krylov solver in matrix-free mode
+  struct tangentOperator: public Subscriptor{
+    tangentOperator(const ellipticBVP<dim>& _problem): problem(_problem) {}
+    types::global_dof_index m() const {return problem.dofHandler.n_dofs();}
+    types::global_dof_index n() const {return problem.dofHandler.n_dofs();}
+    void vmult(vectorType& dst, const vectorType& src) const {problem.applyTangent(dst, src);}
+    const ellipticBVP<dim>& problem;
+  };
+  struct tangentPreconditioner{
+    tangentPreconditioner(const vectorType& _inverseDiagonal): inverseDiagonal(_inverseDiagonal) {}
+    void vmult(vectorType& dst, const vectorType& src) const {dst=src; dst.scale(inverseDiagonal);}
+    const vectorType& inverseDiagonal;
+  };
   bool solveNonLinearSystem();
   void solve();
   void output();
+  //checkpoint/restart (see checkpoint.cc)
+  void writeCheckpoint();
+  void readCheckpoint();
+  std::string checkpointDirectory();
+  unsigned int publishedCheckpoint();
+  std::string checkpointFileName(const unsigned int n);
   void initProject();
   void project();
+  //refinement, coarsening and repartitioning of the mesh with the history of the material
+  //model transferred to the new cells, and load balancing by the measured constitutive
+  //cost of the cells (see repartition.cc)
+  typedef typename parallel::distributed::Triangulation<dim>::cell_iterator triangulationCellIterator;
+  typedef typename parallel::distributed::Triangulation<dim>::CellStatus cellStatus;
+  void updateMesh(const bool useCellWeights=false);
+  void balanceLoad();
+  unsigned int cellWeight(const triangulationCellIterator& cell, const cellStatus status);
+  void initQuadPointTransfer();
+  void packTransferData(const triangulationCellIterator& cell, const cellStatus status, void* data);
+  void unpackTransferData(const triangulationCellIterator& cell, const cellStatus status, const void* data);
+  //nearest quadrature point of the parent for the quadrature points of every child, and
+  //child and nearest child quadrature point for the quadrature points of the parent
+  std::vector<std::vector<unsigned int> > parentQuadPoint;
+  std::vector<std::pair<unsigned int, unsigned int> > childQuadPoint;
+  //assembly time of the constitutive update of the locally owned cells since the last load balancing
+  bool measureCellCost;
+  std::vector<double> cellCost;
+  double meanCellCost;
 
   //virtual methods to be implemented in derived class
   //method to calculate elemental Jacobian and Residual,
@@ -81,14 +160,65 @@ class ellipticBVP
 				  unsigned int num_quad_points,
 				  FullMatrix<double>& elementalJacobian,
 				  Vector<double>&     elementalResidual) = 0;
-#endif  
+
+  //multithreaded assembly data structures and methods (see assembleMultithreaded.cc).
+  //per-thread scratch data
+  struct assemblyScratchData{
+    assemblyScratchData(const FiniteElement<dim>& fe, const Quadrature<dim>& quadrature, const UpdateFlags flags);
+    assemblyScratchData(const assemblyScratchData& scratch);
+    FEValues<dim> fe_values;
+  };
+  //per-cell data handed from the worker threads to the global scatter
+  struct assemblyCopyData{
+    FullMatrix<double> elementalJacobian;
+    Vector<double> elementalResidual;
+    std::vector<types::global_dof_index> local_dof_indices;
+  };
+  void assembleOnCell(const typename DoFHandler<dim>::active_cell_iterator& cell, assemblyScratchData& scratch, assemblyCopyData& copyData);
+  void copyLocalToGlobal(const assemblyCopyData& copyData);
+  void copyLocalToGlobalLocked(const assemblyCopyData& copyData);
+  void copyLocalToBuffer(const assemblyCopyData& copyData);
+  void copyLocalToPrivateBuffer(const assemblyCopyData& copyData);
+  void initMultithreadedAssembly(const CompressedSimpleSparsityPattern& csp);
+  void assembleMultithreaded();
+  void benchmarkAssembly();
+  //scatter of the elemental values into the global system ("copier", "mutex", "colored" or "private")
+  std::string assemblyScatter;
+  //cell coloring (cells of the same color share no dofs) for the "colored" scatter
+  typedef FilteredIterator<typename DoFHandler<dim>::active_cell_iterator> ownedCellIterator;
+  std::vector<std::vector<ownedCellIterator> > assemblyColoring;
+  std::vector<types::global_dof_index> getConflictIndices(const ownedCellIterator& cell) const;
+  //staging buffers for the "colored" (shared) and "private" (one per thread) scatter
+  assemblyBuffer sharedAssemblyBuffer;
+  Threads::ThreadLocalStorage<std_cxx11::shared_ptr<assemblyBuffer> > threadAssemblyBuffer;
+  std::vector<std_cxx11::shared_ptr<assemblyBuffer> > privateAssemblyBuffers;
+#endif
   //methods to allow for pre/post iteration updates
   virtual void updateBeforeIteration();
+  virtual void updateAfterAssembly();
   virtual void updateAfterIteration();
   virtual bool testConvergenceAfterIteration();
   //methods to allow for pre/post increment updates
   virtual void updateBeforeIncrement();
   virtual void updateAfterIncrement();
+  bool isLastIncrement();
+  //methods to write/read the state of the material model that is not attached to the cells to/from
+  //a checkpoint (the history is stored with the mesh by the methods below)
+  virtual void writeCheckpointData(std::ostream& out);
+  virtual void readCheckpointData(std::istream& in);
+  //methods to move the history of the material model to the cells of a new mesh (see
+  //updateMesh): number of doubles and pack/unpack of the values of a quadrature point and
+  //of a cell, allocation for the cells of the new mesh, and update of the derived data
+  virtual unsigned int historyDataSize();
+  virtual void packHistoryData(const unsigned int cellID, const unsigned int q, double* data);
+  virtual void unpackHistoryData(const unsigned int cellID, const unsigned int q, const double* data);
+  virtual unsigned int cellHistoryDataSize();
+  virtual void packCellHistoryData(const unsigned int cellID, double* data);
+  virtual void unpackCellHistoryData(const unsigned int cellID, const double* data);
+  virtual void reinitHistoryData(const unsigned int numLocalCells);
+  virtual void updateAfterMeshChange();
+  //method to set refinement and coarsening flags after an increment. Returns true if any cell was flagged
+  virtual bool markCellsForRefinement();
   
   //methods to apply dirichlet BC's and initial conditions
   void applyDirichletBCs();
@@ -108,7 +238,22 @@ class ellipticBVP
   bool resetIncrement;
   double loadFactorSetByModel;
   double totalLoadFactor;
-  
+  //no. of successive converged increments (adaptive time stepping)
+  unsigned int successiveIncs;
+
+  //multithreaded assembly: set to true by material models whose
+  //getElementalValues can be called concurrently on different cells.
+  //Such models must initialize their data structures before the first
+  //assembly (e.g. in updateBeforeIteration), not inside getElementalValues
+  bool multithreadedAssemblySupported;
+  //refinement and load balancing: set to true by material models that move their history to the cells of a new mesh (see above)
+  bool repartitionSupported;
+  //matrix-free tangent: set to true by material models whose elemental jacobian is the sum of
+  //B^T*dP/dF*B*JxW over the quadrature points and that hand dP/dF to storeQuadPointTangent
+  bool matrixFreeTangentSupported;
+  //lock for data shared between threads during assembly (e.g. resetIncrement, loadFactorSetByModel)
+  Threads::Mutex assemblyMutex;
+
   //parallel message stream
   ConditionalOStream  pcout;  
   
@@ -127,7 +272,16 @@ class ellipticBVP
   //postprocessing data structures
   std::vector<vectorType*> postFields, postFieldsWithGhosts, postResidual;
   matrixType massMatrix;
+  //projection method ("l2" or "lumped"), preconditioner of the mass matrix and inverse lumped mass matrix
+  std::string projectionMethod;
+  std_cxx11::shared_ptr<PETScWrappers::PreconditionJacobi> massMatrixPreconditioner;
+  vectorType invLumpedMass;
   Table<4,double> postprocessValues;
+  //output file type ("pvtu", "vtu" or "hdf5", see output.cc) and the xdmf record of the hdf5 output
+  std::string outputFormat;
+#ifdef DEAL_II_WITH_HDF5
+  std::vector<XDMFEntry> xdmfEntries;
+#endif
 
   //user model related variables and methods
 #ifdef enableUserModel
@@ -143,18 +297,24 @@ class ellipticBVP
 #include "../src/ellipticBVP/ellipticBVP.cc"
 #include "../src/ellipticBVP/run.cc"
 #include "../src/ellipticBVP/mesh.cc"
+#include "../src/ellipticBVP/externalMesh.cc"
 #include "../src/ellipticBVP/init.cc"
 //#include "../src/ellipticBVP/markBoundaries.cc"
 #include "../src/ellipticBVP/initialConditions.cc"
 #include "../src/ellipticBVP/boundaryConditions.cc"
 #include "../src/ellipticBVP/assemble.cc"
+#include "../src/ellipticBVP/assembleMultithreaded.cc"
 #include "../src/ellipticBVP/solve.cc"
 #include "../src/ellipticBVP/solveNonLinearSystem.cc"
 #include "../src/ellipticBVP/solveLinearSystem.cc"
+#include "../src/ellipticBVP/preconditioner.cc"
+#include "../src/ellipticBVP/matrixFreeTangent.cc"
 #include "../src/ellipticBVP/iterationUpdates.cc"
 #include "../src/ellipticBVP/incrementUpdates.cc"
 #include "../src/ellipticBVP/output.cc"
+#include "../src/ellipticBVP/checkpoint.cc"
 #include "../src/ellipticBVP/project.cc"
+#include "../src/ellipticBVP/repartition.cc"
 #include "../src/ellipticBVP/userModelMethods.cc"
 
 #endif
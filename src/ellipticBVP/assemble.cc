@@ -13,7 +13,12 @@ void ellipticBVP<dim>::assemble(){
   //switch to the correct write state. For  details look at the documentation
   //for PETScWrappers::MPI::Vector()
   residual.compress(VectorOperation::add); residual=0.0; 
-  jacobian.compress(VectorOperation::add); jacobian=0.0;
+  if (matrixFreeTangent){
+    inverseTangentDiagonal.compress(VectorOperation::add); inverseTangentDiagonal=0.0;
+  }
+  else{
+    jacobian.compress(VectorOperation::add); jacobian=0.0;
+  }
 
   //local variables
   QGauss<dim>  quadrature(quadOrder);
@@ -27,97 +32,119 @@ void ellipticBVP<dim>::assemble(){
   //apply Dirichlet BC's
   applyDirichletBCs();  
 
+  //multithreaded assembly, if enabled in parameters.h and supported by the material model
+  bool multithreaded=false;
+#ifndef enableUserModel
+#ifdef enableMultithreadedAssembly
+  multithreaded=(enableMultithreadedAssembly && multithreadedAssemblySupported && (assemblyScatter!="serial"));
+#endif
+#endif
+
   try{
-    //parallel loop over all elements
-    typename DoFHandler<dim>::active_cell_iterator cell = dofHandler.begin_active(), endc = dofHandler.end();
-    unsigned int cellID=0;
-    for (; cell!=endc; ++cell) {
-      if (cell->is_locally_owned()){
-	elementalJacobian = 0;
-	elementalResidual = 0;
-	cell->set_user_index(cellID);
+#ifndef enableUserModel
+    //thread-parallel loop over all elements (see assembleMultithreaded.cc)
+    if (multithreaded) assembleMultithreaded();
+#endif
+    //parallel loop over all elements (if the thread-parallel loop was not used)
+    if (!multithreaded){
+      typename DoFHandler<dim>::active_cell_iterator cell = dofHandler.begin_active(), endc = dofHandler.end();
+      unsigned int cellID=0;
+      for (; cell!=endc; ++cell) {
+	if (cell->is_locally_owned()){
+	  elementalJacobian = 0;
+	  elementalResidual = 0;
+	  cell->set_user_index(cellID);
 	
-	//Compute values for the current element
-	fe_values.reinit (cell);
-	cell->get_dof_indices (local_dof_indices);
+	  //Compute values for the current element
+	  fe_values.reinit (cell);
+	  cell->get_dof_indices (local_dof_indices);
+	  const double cellStartTime=(measureCellCost ? MPI_Wtime() : 0.0);
 	
 #ifdef enableUserModel
-	//fill component indices
-	std::vector<unsigned int> componentIndices(dofs_per_cell);
-	for (unsigned int d1=0; d1<dofs_per_cell; ++d1) {
-	  componentIndices[d1] = fe_values.get_fe().system_to_component_index(d1).first;
-	}
-	//quadrature loop
-	for (unsigned int q=0; q<num_quad_points; ++q){
-	  std::vector<double> quadResidual(dofs_per_cell, 0.0), quadJacobian(dofs_per_cell*dofs_per_cell, 0.0);
-
-	  //load history variables
-	  std::vector<double> history(numQuadHistoryVariables);
-	  for (unsigned int i=0; i<numQuadHistoryVariables; i++){
-	    history[i]= quadHistory(cellID, q, i);
+	  //fill component indices
+	  std::vector<unsigned int> componentIndices(dofs_per_cell);
+	  for (unsigned int d1=0; d1<dofs_per_cell; ++d1) {
+	    componentIndices[d1] = fe_values.get_fe().system_to_component_index(d1).first;
 	  }
+	  //quadrature loop
+	  for (unsigned int q=0; q<num_quad_points; ++q){
+	    std::vector<double> quadResidual(dofs_per_cell, 0.0), quadJacobian(dofs_per_cell*dofs_per_cell, 0.0);
 
-	  //load shape function values and shape function gradient values
-	  std::vector<double> shapeValues(dofs_per_cell), shapeGrads(dofs_per_cell*dim);
-	  for (unsigned int d1=0; d1<dofs_per_cell; ++d1) {
-	    shapeValues[d1]=fe_values.shape_value(d1, q);
-	    for (unsigned int i=0; i<dim; ++i) {
-	      shapeGrads[d1*dim+i]=fe_values.shape_grad(d1, q)[i];
+	    //load history variables
+	    std::vector<double> history(numQuadHistoryVariables);
+	    for (unsigned int i=0; i<numQuadHistoryVariables; i++){
+	      history[i]= quadHistory(cellID, q, i);
+	    }
+
+	    //load shape function values and shape function gradient values
+	    std::vector<double> shapeValues(dofs_per_cell), shapeGrads(dofs_per_cell*dim);
+	    for (unsigned int d1=0; d1<dofs_per_cell; ++d1) {
+	      shapeValues[d1]=fe_values.shape_value(d1, q);
+	      for (unsigned int i=0; i<dim; ++i) {
+		shapeGrads[d1*dim+i]=fe_values.shape_grad(d1, q)[i];
+	      }
 	    }
-	  }
 	  
-	  //compute the deformation gradient at this quad point
-	  double gradU[dim*dim], F[dim*dim];
-	  for (unsigned int d1=0; d1<dim*dim; ++d1){
-	    gradU[d1]=0.0;
-	  }
-	  for (unsigned int d1=0; d1<dofs_per_cell; ++d1){
-	    unsigned int i = fe_values.get_fe().system_to_component_index(d1).first;
-	    for (unsigned int j=0; j<dim; ++j){
-	      double ULocal=solutionWithGhosts[local_dof_indices[d1]];
-	      gradU[i*dim+j]+=ULocal*fe_values.shape_grad(d1, q)[j];
+	    //compute the deformation gradient at this quad point
+	    double gradU[dim*dim], F[dim*dim];
+	    for (unsigned int d1=0; d1<dim*dim; ++d1){
+	      gradU[d1]=0.0;
 	    }
-	  }
-	   //F=1+gradU
-	  for (unsigned int i=0; i<dim; ++i){
-	    for (unsigned int j=0; j<dim; ++j){
-	      F[i*dim+j] = (i==j) + gradU[i*dim+j];
+	    for (unsigned int d1=0; d1<dofs_per_cell; ++d1){
+	      unsigned int i = fe_values.get_fe().system_to_component_index(d1).first;
+	      for (unsigned int j=0; j<dim; ++j){
+		double ULocal=solutionWithGhosts[local_dof_indices[d1]];
+		gradU[i*dim+j]+=ULocal*fe_values.shape_grad(d1, q)[j];
+	      }
+	    }
+	     //F=1+gradU
+	    for (unsigned int i=0; i<dim; ++i){
+	      for (unsigned int j=0; j<dim; ++j){
+		F[i*dim+j] = (i==j) + gradU[i*dim+j];
+	      }
 	    }
-	  }
 
-	  //call the getQuadratureValues method supplied by the user in the userModel
-	  getQuadratureValues(cellID,
-			      dofs_per_cell,
-			      &componentIndices[0],
-			      &shapeValues[0],
-			      &shapeGrads[0],
-			      &F[0],
-			      &quadResidual[0],
-			      &quadJacobian[0],
-			      &history[0]);
-	  //update elemental residual and jacobian
-	  for (unsigned int d1=0; d1<dofs_per_cell; ++d1) {
-	    elementalResidual[d1]+=quadResidual[d1]*fe_values.JxW(q);
-	    for (unsigned int d2=0; d2<dofs_per_cell; ++d2) {
-	      elementalJacobian(d1,d2)+=quadJacobian[d1*dofs_per_cell+d2]*fe_values.JxW(q);
+	    //call the getQuadratureValues method supplied by the user in the userModel
+	    getQuadratureValues(cellID,
+				dofs_per_cell,
+				&componentIndices[0],
+				&shapeValues[0],
+				&shapeGrads[0],
+				&F[0],
+				&quadResidual[0],
+				&quadJacobian[0],
+				&history[0]);
+	    //update elemental residual and jacobian
+	    for (unsigned int d1=0; d1<dofs_per_cell; ++d1) {
+	      elementalResidual[d1]+=quadResidual[d1]*fe_values.JxW(q);
+	      for (unsigned int d2=0; d2<dofs_per_cell; ++d2) {
+		elementalJacobian(d1,d2)+=quadJacobian[d1*dofs_per_cell+d2]*fe_values.JxW(q);
+	      }
 	    }
+	    //store history variables
+	    for (unsigned int i=0; i<numQuadHistoryVariables; i++){
+	     quadHistory(cellID, q, i)= history[i];
+	    }	  
 	  }
-	  //store history variables
-	  for (unsigned int i=0; i<numQuadHistoryVariables; i++){
-	   quadHistory(cellID, q, i)= history[i];
-	  }	  
-	}
 #else	
-	//get elemental jacobian and residual
-	getElementalValues(fe_values, dofs_per_cell, num_quad_points, elementalJacobian, elementalResidual);
+	  //get elemental jacobian and residual
+	  getElementalValues(fe_values, dofs_per_cell, num_quad_points, elementalJacobian, elementalResidual);
 #endif
-	//
-	constraints.distribute_local_to_global(elementalJacobian, 
-					       elementalResidual,
-					       local_dof_indices,
-					       jacobian, 
-					       residual);
-	cellID++;
+	  //constitutive cost of the cell (load balancing)
+	  if (measureCellCost) cellCost[cellID]+=MPI_Wtime()-cellStartTime;
+	  //
+	  if (matrixFreeTangent){
+	    storeElementalTangent(elementalJacobian, elementalResidual, local_dof_indices);
+	  }
+	  else{
+	    constraints.distribute_local_to_global(elementalJacobian, 
+						   elementalResidual,
+						   local_dof_indices,
+						   jacobian, 
+						   residual);
+	  }
+	  cellID++;
+	}
       }
     }
   }
@@ -133,7 +160,12 @@ void ellipticBVP<dim>::assemble(){
   
   //MPI operation to sync data 
   residual.compress(VectorOperation::add);
-  jacobian.compress(VectorOperation::add);
+  if (matrixFreeTangent){
+    finalizeMatrixFreeTangent();
+  }
+  else{
+    jacobian.compress(VectorOperation::add);
+  }
   //pcout << "boundary size: " << boundary_values.size() << "\n";
   //MatrixTools::apply_boundary_values (boundary_values, jacobian, solution, residual, false);
   //pcout << "boundary size: " << residual.linfty_norm() << "\n";
@@ -0,0 +1,272 @@
+//multithreaded assemble method for ellipticBVP class
+
+#ifndef ASSEMBLEMULTITHREADED_H
+#define ASSEMBLEMULTITHREADED_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+#ifndef enableUserModel
+
+//scratch data constructors
+template <int dim>
+ellipticBVP<dim>::assemblyScratchData::assemblyScratchData(const FiniteElement<dim>& fe, const Quadrature<dim>& quadrature, const UpdateFlags flags)
+  :
+  fe_values (fe, quadrature, flags)
+{}
+
+template <int dim>
+ellipticBVP<dim>::assemblyScratchData::assemblyScratchData(const assemblyScratchData& scratch)
+  :
+  fe_values (scratch.fe_values.get_fe(), scratch.fe_values.get_quadrature(), scratch.fe_values.get_update_flags())
+{}
+
+//dofs (including constraint masters) written to by the scatter of a cell. Used for the cell coloring
+template <int dim>
+std::vector<types::global_dof_index> ellipticBVP<dim>::getConflictIndices(const ownedCellIterator& cell) const{
+  std::vector<types::global_dof_index> local_dof_indices(FE.dofs_per_cell);
+  cell->get_dof_indices (local_dof_indices);
+  constraints.resolve_indices (local_dof_indices);
+  return local_dof_indices;
+}
+
+//initialize the cell coloring and the staging buffers needed by the selected scatter type.
+//called from init() every time the dofs are distributed
+template <int dim>
+void ellipticBVP<dim>::initMultithreadedAssembly(const CompressedSimpleSparsityPattern& csp){
+  assemblyColoring.clear();
+  sharedAssemblyBuffer=assemblyBuffer();
+  privateAssemblyBuffers.clear();
+  threadAssemblyBuffer.clear();
+
+  bool benchmark=false;
+#ifdef benchmarkAssemblyScatter
+  benchmark=benchmarkAssemblyScatter;
+#endif
+  if (!multithreadedAssemblySupported) return;
+
+  if (benchmark || (assemblyScatter=="colored")){
+    assemblyColoring=GraphColoring::make_graph_coloring(ownedCellIterator(IteratorFilters::LocallyOwnedCell(), dofHandler.begin_active()),
+							ownedCellIterator(IteratorFilters::LocallyOwnedCell(), dofHandler.end()),
+							std_cxx11::function<std::vector<types::global_dof_index> (const ownedCellIterator&)>
+							(std_cxx11::bind(&ellipticBVP<dim>::getConflictIndices, this, std_cxx11::_1)));
+    unsigned int numColors=Utilities::MPI::max((unsigned int) assemblyColoring.size(), mpi_communicator);
+    pcout << "number of cell colors for multithreaded assembly: " << numColors << std::endl;
+  }
+  if (benchmark || (assemblyScatter=="colored") || (assemblyScatter=="private")){
+    sharedAssemblyBuffer.reinit(locally_relevant_dofs, csp);
+  }
+}
+
+//compute the elemental jacobian and residual of one cell (called concurrently by the worker threads)
+template <int dim>
+void ellipticBVP<dim>::assembleOnCell(const typename DoFHandler<dim>::active_cell_iterator& cell, assemblyScratchData& scratch, assemblyCopyData& copyData){
+  const unsigned int   dofs_per_cell   = FE.dofs_per_cell;
+  const unsigned int   num_quad_points = scratch.fe_values.n_quadrature_points;
+  copyData.elementalJacobian.reinit(dofs_per_cell, dofs_per_cell);
+  copyData.elementalResidual.reinit(dofs_per_cell);
+  copyData.local_dof_indices.resize(dofs_per_cell);
+  cell->get_dof_indices (copyData.local_dof_indices);
+
+  //nothing left to do once the material model has requested to reset the increment
+  //(resetIncrement is set under assemblyMutex, see inactiveSlipRemoval)
+  {
+    Threads::Mutex::ScopedLock lock(assemblyMutex);
+    if (resetIncrement) return;
+  }
+
+  scratch.fe_values.reinit (cell);
+  try{
+    const double cellStartTime=(measureCellCost ? MPI_Wtime() : 0.0);
+    getElementalValues(scratch.fe_values, dofs_per_cell, num_quad_points, copyData.elementalJacobian, copyData.elementalResidual);
+    //constitutive cost of the cell (load balancing). Every cell is assembled by one thread
+    if (measureCellCost) cellCost[cell->user_index()]+=MPI_Wtime()-cellStartTime;
+  }
+  catch (int param){
+    //resetIncrement has been set by the material model. Zero the partially filled
+    //elemental data, as the assembled system will be discarded anyway
+    copyData.elementalJacobian=0;
+    copyData.elementalResidual=0;
+  }
+}
+
+//"copier" scatter: called by one thread at a time (serialized by WorkStream)
+template <int dim>
+void ellipticBVP<dim>::copyLocalToGlobal(const assemblyCopyData& copyData){
+  if (matrixFreeTangent){
+    //residual and diagonal, the tangents were stored by the worker (see matrixFreeTangent.cc)
+    storeElementalTangent(copyData.elementalJacobian, copyData.elementalResidual, copyData.local_dof_indices);
+    return;
+  }
+  constraints.distribute_local_to_global(copyData.elementalJacobian,
+					 copyData.elementalResidual,
+					 copyData.local_dof_indices,
+					 jacobian,
+					 residual);
+}
+
+//"mutex" scatter: called concurrently, the PETSc objects are guarded by a lock
+template <int dim>
+void ellipticBVP<dim>::copyLocalToGlobalLocked(const assemblyCopyData& copyData){
+  Threads::Mutex::ScopedLock lock(assemblyMutex);
+  copyLocalToGlobal(copyData);
+}
+
+//"colored" scatter: called concurrently for cells of the same color, which
+//write into different rows of the shared buffer
+template <int dim>
+void ellipticBVP<dim>::copyLocalToBuffer(const assemblyCopyData& copyData){
+  constraints.distribute_local_to_global(copyData.elementalJacobian,
+					 copyData.elementalResidual,
+					 copyData.local_dof_indices,
+					 sharedAssemblyBuffer.jacobian,
+					 sharedAssemblyBuffer.residual);
+}
+
+//"private" scatter: every thread writes into its own buffer, the buffers are summed at the end
+template <int dim>
+void ellipticBVP<dim>::copyLocalToPrivateBuffer(const assemblyCopyData& copyData){
+  std_cxx11::shared_ptr<assemblyBuffer>& buffer=threadAssemblyBuffer.get();
+  if (!buffer){
+    //first use in this thread: copy the (zero) buffer structure and register it for the reduction
+    buffer.reset(new assemblyBuffer(sharedAssemblyBuffer));
+    buffer->zero();
+    Threads::Mutex::ScopedLock lock(assemblyMutex);
+    privateAssemblyBuffers.push_back(buffer);
+  }
+  constraints.distribute_local_to_global(copyData.elementalJacobian,
+					 copyData.elementalResidual,
+					 copyData.local_dof_indices,
+					 buffer->jacobian,
+					 buffer->residual);
+}
+
+//thread-parallel loop over the locally owned elements
+template <int dim>
+void ellipticBVP<dim>::assembleMultithreaded(){
+  QGauss<dim>  quadrature(quadOrder);
+
+  //cellID's are assigned serially, as the material models index their
+  //history variables by the user_index of the cell
+  std::vector<std::vector<ownedCellIterator> > ownedCells(1);
+  unsigned int cellID=0;
+  typename DoFHandler<dim>::active_cell_iterator cell = dofHandler.begin_active(), endc = dofHandler.end();
+  for (; cell!=endc; ++cell) {
+    if (cell->is_locally_owned()){
+      cell->set_user_index(cellID);
+      ownedCells[0].push_back(ownedCellIterator(IteratorFilters::LocallyOwnedCell(), cell));
+      cellID++;
+    }
+  }
+  if (cellID==0) return;
+
+  assemblyScratchData scratch(FE, quadrature, update_values | update_gradients | update_JxW_values);
+  assemblyCopyData copyData;
+  std_cxx11::function<void (const typename DoFHandler<dim>::active_cell_iterator&, assemblyScratchData&, assemblyCopyData&)>
+    worker=std_cxx11::bind(&ellipticBVP<dim>::assembleOnCell, this, std_cxx11::_1, std_cxx11::_2, std_cxx11::_3);
+
+  //the buffers of the "colored" and "private" scatters stage the jacobian, which is not
+  //assembled with the matrix-free tangent. The "copier" scatter is used instead
+  std::string scatter=assemblyScatter;
+  if (matrixFreeTangent && ((scatter=="colored") || (scatter=="private"))) scatter="copier";
+
+  if (scatter=="copier"){
+    //elemental values are scattered by one thread at a time
+    WorkStream::run(ownedCellIterator(IteratorFilters::LocallyOwnedCell(), dofHandler.begin_active()),
+		    ownedCellIterator(IteratorFilters::LocallyOwnedCell(), dofHandler.end()),
+		    worker,
+		    std_cxx11::bind(&ellipticBVP<dim>::copyLocalToGlobal, this, std_cxx11::_1),
+		    scratch,
+		    copyData);
+  }
+  else if (scatter=="mutex"){
+    //the colored WorkStream with a single color calls the copier right after the
+    //worker on the same thread, so the scatter itself has to take the lock
+    WorkStream::run(ownedCells,
+		    worker,
+		    std_cxx11::bind(&ellipticBVP<dim>::copyLocalToGlobalLocked, this, std_cxx11::_1),
+		    scratch,
+		    copyData);
+  }
+  else if (scatter=="colored"){
+    //colors are processed one after another, cells of the same color
+    //are scattered concurrently into the shared buffer without locks
+    sharedAssemblyBuffer.zero();
+    WorkStream::run(assemblyColoring,
+		    worker,
+		    std_cxx11::bind(&ellipticBVP<dim>::copyLocalToBuffer, this, std_cxx11::_1),
+		    scratch,
+		    copyData);
+    sharedAssemblyBuffer.addTo(jacobian, residual);
+  }
+  else if (scatter=="private"){
+    for (unsigned int i=0; i<privateAssemblyBuffers.size(); i++){
+      privateAssemblyBuffers[i]->zero();
+    }
+    WorkStream::run(ownedCells,
+		    worker,
+		    std_cxx11::bind(&ellipticBVP<dim>::copyLocalToPrivateBuffer, this, std_cxx11::_1),
+		    scratch,
+		    copyData);
+    //reduce the per-thread buffers
+    for (unsigned int i=1; i<privateAssemblyBuffers.size(); i++){
+      privateAssemblyBuffers[0]->add(*privateAssemblyBuffers[i]);
+    }
+    if (privateAssemblyBuffers.size()>0){
+      privateAssemblyBuffers[0]->addTo(jacobian, residual);
+    }
+  }
+  else{
+    pcout << "\nError: unknown assemblyScatterType " << scatter << ". Use \"copier\", \"mutex\", \"colored\" or \"private\".\n\n";
+    exit (-1);
+  }
+
+  if (resetIncrement){
+    std::cout << "skipping assembly and nonlinear solve as resetIncrement==True\n";
+  }
+}
+
+//compare the wall time of the serial assembly and of the multithreaded assembly
+//with the different scatter types. Called once before the first increment
+template <int dim>
+void ellipticBVP<dim>::benchmarkAssembly(){
+  if (!multithreadedAssemblySupported){
+    pcout << "multithreaded assembly not supported by this material model, skipping assembly benchmark\n";
+    return;
+  }
+  if (matrixFreeTangent){
+    pcout << "the scatter types stage the assembled jacobian, skipping assembly benchmark with the matrix-free tangent\n";
+    return;
+  }
+  const unsigned int numRepetitions=3;
+  const std::string scatterTypes[]={"serial", "copier", "mutex", "colored", "private"};
+  const std::string userScatter=assemblyScatter;
+  const double userLoadFactor=loadFactorSetByModel;
+  char buffer[200];
+  sprintf(buffer, "\nassembly benchmark (%u threads per MPI process, best of %u assemblies)\n", MultithreadInfo::n_threads(), numRepetitions);
+  pcout << buffer;
+  for (unsigned int type=0; type<5; type++){
+    assemblyScatter=scatterTypes[type];
+    double minTime=1.0e+300;
+    for (unsigned int rep=0; rep<numRepetitions; rep++){
+      updateBeforeIteration();
+      Timer timer(mpi_communicator, true);
+      assemble();
+      timer.stop();
+      minTime=std::min(minTime, timer.wall_time());
+    }
+    sprintf(buffer, "%-8s: %10.4e s [residual norm: %12.6e, jacobian norm: %12.6e]\n", assemblyScatter.c_str(), minTime, residual.l2_norm(), jacobian.frobenius_norm());
+    pcout << buffer;
+  }
+  pcout << "\n";
+  //restore state. The constitutive cost of the cells (load balancing) and the per-core
+  //totals of the material model must not include the benchmark assemblies
+  assemblyScatter=userScatter;
+  resetIncrement=false;
+  loadFactorSetByModel=userLoadFactor;
+  std::fill(cellCost.begin(), cellCost.end(), 0.0);
+  updateBeforeIteration();
+}
+
+#endif
+
+#endif
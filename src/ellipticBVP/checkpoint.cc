@@ -0,0 +1,274 @@
+//checkpoint/restart methods for ellipticBVP class
+
+#ifndef CHECKPOINT_ELLIPTICBVP_H
+#define CHECKPOINT_ELLIPTICBVP_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//A checkpoint consists of the distributed mesh saved by p4est (checkpoint-<n>.mesh
+//and checkpoint-<n>.mesh.info in outputDirectory) and a binary file written by
+//processor 0 (checkpoint-<n>.bin), where n counts the checkpoints written in
+//outputDirectory. The displacements (converged solution and last solution
+//increment) and the history of the material model are attached to the cells of
+//the saved mesh, the history with the same per cell layout as in updateMesh
+//(packTransferData). checkpoint-<n>.bin holds the increment counters and load
+//factors, the xdmf record of the hdf5 output and the state of the material model
+//that is not attached to the cells (writeCheckpointData). On restart the mesh generated by mesh() is coarsened to
+//its coarse cells and the refinement of the checkpoint is loaded on top of it,
+//so the mesh may have been refined or repartitioned (updateMesh, balanceLoad)
+//before the checkpoint was written. The coarse mesh must be the same.
+//
+//A checkpoint is published by the pointer file checkpoint.latest, which holds n
+//and is replaced by an atomic rename once every process has written its part.
+//An interrupted or failed checkpoint leaves the previous one published, which is
+//removed only after the new one has been published.
+
+//directory of the checkpoint files
+template <int dim>
+std::string ellipticBVP<dim>::checkpointDirectory(){
+#ifdef outputDirectory
+  std::string dir(outputDirectory);
+  dir+="/";
+#else
+  std::string dir("./");
+#endif
+  return dir;
+}
+
+//number n of the published checkpoint (0: none)
+template <int dim>
+unsigned int ellipticBVP<dim>::publishedCheckpoint(){
+  unsigned int n=0;
+  std::ifstream pointer((checkpointDirectory()+"checkpoint.latest").c_str());
+  if (!(pointer >> n)) n=0;
+  return n;
+}
+
+//base name of the files of checkpoint n
+template <int dim>
+std::string ellipticBVP<dim>::checkpointFileName(const unsigned int n){
+  char buffer[20];
+  sprintf(buffer, "checkpoint-%u", n);
+  return checkpointDirectory()+buffer;
+}
+
+//write the state after the converged increment currentIncrement
+template <int dim>
+void ellipticBVP<dim>::writeCheckpoint(){
+  AssertThrow(repartitionSupported, ExcMessage("the material model does not support the transfer of its history to the cells of a checkpoint"));
+  //increment the solve loop starts with after a restart
+  unsigned int restartIncrement=currentIncrement+1;
+#ifdef enableAdaptiveTimeStepping
+#if enableAdaptiveTimeStepping==true
+  //(the adaptive loop increments currentIncrement at its start)
+  restartIncrement=currentIncrement;
+#endif
+#endif
+  //(read by processor 0, which replaces the pointer file)
+  const unsigned int previousCheckpoint=Utilities::MPI::max((Utilities::MPI::this_mpi_process(mpi_communicator)==0) ? publishedCheckpoint() : 0u, mpi_communicator);
+  const std::string filename=checkpointFileName(previousCheckpoint+1);
+
+  //the history of the material model is indexed by the cellID's of the current mesh
+  typename DoFHandler<dim>::active_cell_iterator cell = dofHandler.begin_active(), endc = dofHandler.end();
+  unsigned int cellID=0;
+  for (; cell!=endc; ++cell) {
+    if (cell->is_locally_owned()) cell->set_user_index(cellID++);
+  }
+
+  //displacements, then the history (read back in the same order by readCheckpoint)
+  vectorType previousIncrementSolutionWithGhosts(locally_owned_dofs, locally_relevant_dofs, mpi_communicator);
+  previousIncrementSolutionWithGhosts=previousIncrementSolution;
+  solutionWithGhosts=solution;
+  std::vector<const vectorType*> vectors(2);
+  vectors[0]=&solutionWithGhosts;
+  vectors[1]=&previousIncrementSolutionWithGhosts;
+  parallel::distributed::SolutionTransfer<dim, vectorType> solutionTransfer(dofHandler);
+  solutionTransfer.prepare_serialization(vectors);
+  initQuadPointTransfer();
+  const unsigned int transferSize=cellHistoryDataSize()+parentQuadPoint[0].size()*historyDataSize();
+  if (transferSize>0){
+    triangulation.register_data_attach(transferSize*sizeof(double),
+				       std_cxx11::bind(&ellipticBVP<dim>::packTransferData, this, std_cxx11::_1, std_cxx11::_2, std_cxx11::_3));
+  }
+  unsigned int failedWrite=0;
+  try{
+    triangulation.save((filename+".mesh").c_str());
+  }
+  catch (...){
+    failedWrite=1;
+  }
+
+  //increment counters, load factors, linear solver statistics and the state of the material model
+  if (Utilities::MPI::this_mpi_process(mpi_communicator)==0){
+    //files of the mesh written by p4est and deal.II
+    std::ifstream mesh((filename+".mesh").c_str()), meshInfo((filename+".mesh.info").c_str());
+    if (!mesh || !meshInfo) failedWrite=1;
+    std::ofstream out((filename+".bin").c_str(), std::ios::binary);
+    checkpointWrite(out, checkpointFormatVersion);
+    checkpointWrite(out, (unsigned int) triangulation.n_cells(0));
+    checkpointWrite(out, (unsigned int) triangulation.n_global_active_cells());
+    checkpointWrite(out, restartIncrement);
+    checkpointWrite(out, successiveIncs);
+    checkpointWrite(out, totalLoadFactor);
+    checkpointWrite(out, loadFactorSetByModel);
+    checkpointWrite(out, previousIncrementLoadFactor);
+    checkpointWrite(out, numLinearSolves);
+    checkpointWrite(out, numLinearIterations);
+    checkpointWrite(out, numPreconditionerSetups);
+    //xdmf record of the hdf5 output written so far (see output())
+    std::ostringstream xdmfRecord;
+#ifdef DEAL_II_WITH_HDF5
+    {
+      boost::archive::binary_oarchive archive(xdmfRecord);
+      archive << xdmfEntries;
+    }
+#endif
+    checkpointWrite(out, xdmfRecord.str());
+    writeCheckpointData(out);
+    out.close();
+    if (!out) failedWrite=1;
+  }
+
+  //publish the checkpoint once every process has written its part
+  if (Utilities::MPI::max(failedWrite, mpi_communicator)>0){
+    pcout << "\nError: writing the checkpoint " << filename << " failed, keeping the previous checkpoint\n\n";
+    return;
+  }
+  unsigned int failedPublish=0;
+  if (Utilities::MPI::this_mpi_process(mpi_communicator)==0){
+    const std::string pointerName=checkpointDirectory()+"checkpoint.latest";
+    std::ofstream pointer((pointerName+".tmp").c_str());
+    pointer << previousCheckpoint+1 << "\n";
+    pointer.close();
+    if (!pointer || (std::rename((pointerName+".tmp").c_str(), pointerName.c_str())!=0)) failedPublish=1;
+    if (!failedPublish && (previousCheckpoint>0)){
+      //files of the previous checkpoint, no longer published
+      const std::string previousFilename=checkpointFileName(previousCheckpoint);
+      const char* suffixes[]={".mesh", ".mesh.info", ".bin"};
+      for (unsigned int i=0; i<3; i++) std::remove((previousFilename+suffixes[i]).c_str());
+    }
+  }
+  if (Utilities::MPI::max(failedPublish, mpi_communicator)>0){
+    pcout << "\nError: publishing the checkpoint " << filename << " failed, keeping the previous checkpoint\n\n";
+    return;
+  }
+  char buffer[200];
+  sprintf(buffer, "checkpoint written after increment %u (total load factor: %12.6e)\n", currentIncrement, totalLoadFactor);
+  pcout << buffer;
+}
+
+//restore the state of the last checkpoint. Called by run() after the mesh and
+//the data structures have been initialized
+template <int dim>
+void ellipticBVP<dim>::readCheckpoint(){
+  AssertThrow(repartitionSupported, ExcMessage("the material model does not support the transfer of its history to the cells of a checkpoint"));
+  const std::string filename=checkpointFileName(publishedCheckpoint());
+  std::ifstream in((filename+".bin").c_str(), std::ios::binary);
+  unsigned int version=0, numCoarseCells=0, numCells=0;
+  checkpointRead(in, version);
+  checkpointRead(in, numCoarseCells);
+  checkpointRead(in, numCells);
+  if (Utilities::MPI::min((unsigned int) (in && (version==checkpointFormatVersion)), mpi_communicator)==0){
+    pcout << "\nError: no checkpoint " << filename << " of this version\n\n";
+    exit (-1);
+  }
+  //(p4est does not check the coarse mesh on loading)
+  if (numCoarseCells!=triangulation.n_cells(0)){
+    pcout << "\nError: the checkpoint " << filename << " does not match the coarse mesh\n\n";
+    exit (-1);
+  }
+
+  //coarse mesh, on which p4est restores the refinement and the attached data of the checkpoint
+  types::global_dof_index numActiveCells=triangulation.n_global_active_cells();
+  while (triangulation.n_global_levels()>1){
+    typename parallel::distributed::Triangulation<dim>::active_cell_iterator cell = triangulation.begin_active(), endc = triangulation.end();
+    for (; cell!=endc; ++cell) {
+      if (cell->is_locally_owned()) cell->set_coarsen_flag();
+    }
+    triangulation.execute_coarsening_and_refinement();
+    //(the same on all processes)
+    if (triangulation.n_global_active_cells()>=numActiveCells){
+      pcout << "\nError: the mesh could not be coarsened to its coarse cells to load the checkpoint\n\n";
+      exit (-1);
+    }
+    numActiveCells=triangulation.n_global_active_cells();
+  }
+  triangulation.load((filename+".mesh").c_str());
+  if (numCells!=triangulation.n_global_active_cells()){
+    pcout << "\nError: the checkpoint " << filename << " is incomplete\n\n";
+    exit (-1);
+  }
+
+  //data structures of the restored mesh and the displacements
+  setupSystem();
+  std::vector<vectorType*> vectors(2);
+  vectors[0]=&solution;
+  vectors[1]=&previousIncrementSolution;
+  parallel::distributed::SolutionTransfer<dim, vectorType> solutionTransfer(dofHandler);
+  solutionTransfer.deserialize(vectors);
+  constraints.distribute(solution);
+  constraints.distribute(previousIncrementSolution);
+  oldSolution=solution;
+  solutionWithGhosts=solution;
+
+  //cellID's of the restored mesh and the history
+  typename DoFHandler<dim>::active_cell_iterator cell = dofHandler.begin_active(), endc = dofHandler.end();
+  unsigned int cellID=0;
+  for (; cell!=endc; ++cell) {
+    if (cell->is_locally_owned()) cell->set_user_index(cellID++);
+  }
+  initQuadPointTransfer();
+  const unsigned int transferSize=cellHistoryDataSize()+parentQuadPoint[0].size()*historyDataSize();
+  reinitHistoryData(cellID);
+  if (transferSize>0){
+    //the offset of the history behind the displacements, the pack function is not called on loading
+    const unsigned int transferOffset=triangulation.register_data_attach(transferSize*sizeof(double),
+									 std_cxx11::bind(&ellipticBVP<dim>::packTransferData, this, std_cxx11::_1, std_cxx11::_2, std_cxx11::_3));
+    triangulation.notify_ready_to_unpack(transferOffset,
+					 std_cxx11::bind(&ellipticBVP<dim>::unpackTransferData, this, std_cxx11::_1, std_cxx11::_2, std_cxx11::_3));
+  }
+  updateAfterMeshChange();
+  //projection of the post-processed fields
+  initProject();
+
+  //increment counters, load factors, linear solver statistics and the state of the material model
+  checkpointRead(in, currentIncrement);
+  checkpointRead(in, successiveIncs);
+  checkpointRead(in, totalLoadFactor);
+  checkpointRead(in, loadFactorSetByModel);
+  checkpointRead(in, previousIncrementLoadFactor);
+  checkpointRead(in, numLinearSolves);
+  checkpointRead(in, numLinearIterations);
+  checkpointRead(in, numPreconditionerSetups);
+  std::string xdmfRecord;
+  checkpointRead(in, xdmfRecord);
+#ifdef DEAL_II_WITH_HDF5
+  xdmfEntries.clear();
+  if (in && (xdmfRecord.size()>0)){
+    std::istringstream xdmfStream(xdmfRecord);
+    boost::archive::binary_iarchive archive(xdmfStream);
+    archive >> xdmfEntries;
+  }
+#endif
+  readCheckpointData(in);
+  AssertThrow(in, ExcMessage("reading the checkpoint "+filename+".bin failed"));
+
+  char buffer[200];
+  sprintf(buffer, "restarting from checkpoint at increment %u (total load factor: %12.6e, %u elements)\n", currentIncrement, totalLoadFactor, numCells);
+  pcout << buffer;
+}
+
+//state of the material model that is not attached to the cells, written by processor 0
+//and read by all processors. Overloaded by the material models. The history of the
+//quadrature points and cells is stored with the mesh (see historyDataSize)
+template <int dim>
+void ellipticBVP<dim>::writeCheckpointData(std::ostream& out){
+  //default method does nothing
+}
+
+template <int dim>
+void ellipticBVP<dim>::readCheckpointData(std::istream& in){
+  //default method does nothing
+}
+
+#endif
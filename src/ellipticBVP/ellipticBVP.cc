@@ -18,12 +18,27 @@ ellipticBVP<dim>::ellipticBVP ()
   FE_Scalar (FE_Q<dim>(feOrder), 1),
   dofHandler (triangulation),
   dofHandler_Scalar (triangulation),
+  jacobianPreconditionerIncrement(0),
+  numLinearSolves(0),
+  numLinearIterations(0),
+  numPreconditionerSetups(0),
+  rebuildPreconditioner(false),
+  linearSolverRelTolerance(relLinearSolverTolerance),
+  previousIncrementLoadFactor(0.0),
+  matrixFreeTangent(false),
+  matrixFreeSinglePrecision(false),
+  measureCellCost(false),
+  meanCellCost(0.0),
   currentIteration(0),
   currentIncrement(0),
   totalIncrements(totalNumIncrements),
   resetIncrement(false),
   loadFactorSetByModel(1.0),
   totalLoadFactor(0.0),
+  successiveIncs(0),
+  multithreadedAssemblySupported(false),
+  repartitionSupported(false),
+  matrixFreeTangentSupported(false),
   pcout (std::cout, Utilities::MPI::this_mpi_process(MPI_COMM_WORLD)==0),
   computing_timer (pcout, TimerOutput::summary, TimerOutput::wall_times),
   numPostProcessedFields(0)
@@ -33,6 +48,53 @@ ellipticBVP<dim>::ellipticBVP ()
     nodal_solution_names.push_back("u");
     nodal_data_component_interpretation.push_back(DataComponentInterpretation::component_is_part_of_vector);
   }
+
+  //scatter type for multithreaded assembly (see assembleMultithreaded.cc)
+#ifndef enableUserModel
+#ifdef assemblyScatterType
+  assemblyScatter=assemblyScatterType;
+#else
+  assemblyScatter="copier";
+#endif
+#endif
+
+  //preconditioner of the displacement solve (see preconditioner.cc)
+#ifdef preconditionerType
+  linearPreconditioner=preconditionerType;
+#else
+  linearPreconditioner="jacobi";
+#endif
+
+  //projection of the post-processed fields (see project.cc)
+#ifdef projectionType
+  projectionMethod=projectionType;
+#else
+  projectionMethod="l2";
+#endif
+
+  //output file type (see output.cc)
+#ifdef outputFileType
+  outputFormat=outputFileType;
+#else
+  outputFormat="pvtu";
+#endif
+
+  //matrix-free tangent (see matrixFreeTangent.cc)
+#ifdef enableMatrixFreeTangent
+  matrixFreeTangent=enableMatrixFreeTangent;
+#endif
+#ifdef matrixFreeTangentSinglePrecision
+  matrixFreeSinglePrecision=matrixFreeTangentSinglePrecision;
+#endif
+
+  //load balancing every loadBalanceInterval increments (see repartition.cc)
+#ifdef loadBalanceInterval
+  measureCellCost=(loadBalanceInterval>0);
+#endif
+#ifdef enableUserModel
+  //the history of user models (quadHistory) is moved by the default methods
+  repartitionSupported=true;
+#endif
 }
 
 //destructor
@@ -0,0 +1,159 @@
+//external mesh import for ellipticBVP class
+
+#ifndef EXTERNALMESH_ELLIPTICBVP_H
+#define EXTERNALMESH_ELLIPTICBVP_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//The coarse mesh of the parallel::distributed::Triangulation is kept on all
+//processors (p4est), but it does not have to be parsed by all of them: processor
+//0 reads the mesh file and broadcasts the vertices, the cells with their material
+//ids and the boundary faces with their boundary and manifold ids, from which every
+//processor creates the triangulation. Gmsh (.msh) files are parsed with GridIn.
+//The binary mesh files written with convertExternalMesh (meshFileMagic, dim,
+//number of vertices, cells and boundary faces as uint64, the vertices as float64,
+//then per cell its vertices and material id and per boundary face its vertices,
+//boundary id and manifold id as uint32) are read directly. Only the boundary faces
+//with a boundary id other than 0 or a manifold id are kept.
+static const char meshFileMagic[8]={'M','E','S','H','B','I','N','2'};
+
+//broadcast of the mesh data of processor 0. The count of MPI_Bcast is an int, the
+//data is broadcast in chunks
+template <typename T>
+void broadcastMeshData(std::vector<T>& data, MPI_Datatype type, MPI_Comm comm){
+  unsigned long long size=data.size();
+  MPI_Bcast(&size, 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+  data.resize(size);
+  const unsigned long long chunkSize=1ull<<28;
+  for (unsigned long long begin=0; begin<size; begin+=chunkSize){
+    MPI_Bcast(&data[begin], (int) std::min(chunkSize, size-begin), type, 0, comm);
+  }
+}
+
+template <int dim>
+void ellipticBVP<dim>::readExternalMesh(const std::string& fileName){
+  pcout << "reading problem mesh\n";
+  const unsigned int verticesPerCell=GeometryInfo<dim>::vertices_per_cell;
+  const unsigned int verticesPerFace=GeometryInfo<dim>::vertices_per_face;
+  std::vector<double> vertexData;
+  std::vector<unsigned int> cellData, faceData;
+  int failed=0;
+  if (Utilities::MPI::this_mpi_process(mpi_communicator)==0){
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    char magic[sizeof(meshFileMagic)];
+    if (!file.is_open()) failed=1;
+    else if (file.read(magic, sizeof(magic)) && (memcmp(magic, meshFileMagic, sizeof(magic))==0)){
+      //binary mesh file
+      unsigned long long header[4];
+      file.read((char*) header, sizeof(header));
+      if (!file || (header[0]!=dim)) failed=1;
+      else{
+	vertexData.resize(header[1]*dim);
+	cellData.resize(header[2]*(verticesPerCell+1));
+	faceData.resize(header[3]*(verticesPerFace+2));
+	file.read((char*) &vertexData[0], vertexData.size()*sizeof(double));
+	file.read((char*) &cellData[0], cellData.size()*sizeof(unsigned int));
+	if (faceData.size()>0) file.read((char*) &faceData[0], faceData.size()*sizeof(unsigned int));
+	if (!file) failed=1;
+      }
+    }
+    else if (file && (memcmp(magic, meshFileMagic, sizeof(magic)-1)==0)){
+      //binary mesh file of an older format, without the boundary faces
+      std::cerr << "binary mesh file " << fileName << " of an older format, convert the gmsh file again\n";
+      failed=1;
+    }
+    else{
+      //gmsh file, parsed into a serial triangulation
+      file.clear();
+      file.seekg(0);
+      Triangulation<dim> coarseMesh;
+      GridIn<dim> gridin;
+      gridin.attach_triangulation(coarseMesh);
+      try{
+	gridin.read_msh(file);
+      }
+      catch (std::exception &exc){
+	std::cerr << exc.what() << std::endl;
+	failed=1;
+      }
+      if (!failed){
+	const std::vector<Point<dim> >& vertices=coarseMesh.get_vertices();
+	for (unsigned int i=0; i<vertices.size(); ++i){
+	  for (unsigned int j=0; j<dim; ++j) vertexData.push_back(vertices[i][j]);
+	}
+	typename Triangulation<dim>::active_cell_iterator cell=coarseMesh.begin_active(), endc=coarseMesh.end();
+	for (; cell!=endc; ++cell){
+	  for (unsigned int v=0; v<verticesPerCell; ++v) cellData.push_back(cell->vertex_index(v));
+	  cellData.push_back(cell->material_id());
+	  //boundary faces with a boundary id or a manifold id
+	  for (unsigned int f=0; f<GeometryInfo<dim>::faces_per_cell; ++f){
+	    if (!cell->face(f)->at_boundary()) continue;
+	    if ((cell->face(f)->boundary_id()==0) && (cell->face(f)->manifold_id()==numbers::invalid_manifold_id)) continue;
+	    for (unsigned int v=0; v<verticesPerFace; ++v) faceData.push_back(cell->face(f)->vertex_index(v));
+	    faceData.push_back(cell->face(f)->boundary_id());
+	    faceData.push_back(cell->face(f)->manifold_id());
+	  }
+	}
+#ifdef convertExternalMesh
+#if convertExternalMesh==true
+	//binary mesh file for the following runs
+	const std::string binaryFileName=fileName+".bin";
+	std::ofstream binaryFile(binaryFileName.c_str(), std::ios::binary);
+	const unsigned long long header[4]={dim, vertices.size(), coarseMesh.n_active_cells(), faceData.size()/(verticesPerFace+2)};
+	binaryFile.write(meshFileMagic, sizeof(meshFileMagic));
+	binaryFile.write((const char*) header, sizeof(header));
+	binaryFile.write((const char*) &vertexData[0], vertexData.size()*sizeof(double));
+	binaryFile.write((const char*) &cellData[0], cellData.size()*sizeof(unsigned int));
+	if (faceData.size()>0) binaryFile.write((const char*) &faceData[0], faceData.size()*sizeof(unsigned int));
+	if (binaryFile) pcout << "binary mesh file written to: " << binaryFileName << "\n";
+	else pcout << "unable to write binary mesh file " << binaryFileName << "\n";
+#endif
+#endif
+      }
+    }
+  }
+  MPI_Bcast(&failed, 1, MPI_INT, 0, mpi_communicator);
+  if (failed){
+    pcout << "\nError: unable to read the external mesh file " << fileName << "\n\n";
+    exit (-1);
+  }
+
+  //broadcast the coarse mesh
+  broadcastMeshData(vertexData, MPI_DOUBLE, mpi_communicator);
+  broadcastMeshData(cellData, MPI_UNSIGNED, mpi_communicator);
+  broadcastMeshData(faceData, MPI_UNSIGNED, mpi_communicator);
+
+  //create the triangulation
+  std::vector<Point<dim> > vertices(vertexData.size()/dim);
+  for (unsigned int i=0; i<vertices.size(); ++i){
+    for (unsigned int j=0; j<dim; ++j) vertices[i][j]=vertexData[i*dim+j];
+  }
+  std::vector<CellData<dim> > cells(cellData.size()/(verticesPerCell+1));
+  for (unsigned int i=0; i<cells.size(); ++i){
+    for (unsigned int v=0; v<verticesPerCell; ++v) cells[i].vertices[v]=cellData[i*(verticesPerCell+1)+v];
+    cells[i].material_id=cellData[i*(verticesPerCell+1)+verticesPerCell];
+  }
+  //boundary faces: lines in 2D, quads in 3D
+  SubCellData boundaryFaces;
+  for (unsigned int i=0; i<faceData.size()/(verticesPerFace+2); ++i){
+    const unsigned int* face=&faceData[i*(verticesPerFace+2)];
+    if (dim==2){
+      CellData<1> line;
+      for (unsigned int v=0; v<2; ++v) line.vertices[v]=face[v];
+      line.boundary_id=face[verticesPerFace];
+      line.manifold_id=face[verticesPerFace+1];
+      boundaryFaces.boundary_lines.push_back(line);
+    }
+    else{
+      CellData<2> quad;
+      for (unsigned int v=0; v<4; ++v) quad.vertices[v]=face[v];
+      quad.boundary_id=face[verticesPerFace];
+      quad.manifold_id=face[verticesPerFace+1];
+      boundaryFaces.boundary_quads.push_back(quad);
+    }
+  }
+  triangulation.create_triangulation(vertices, cells, boundaryFaces);
+  pcout << "external mesh: " << triangulation.n_global_active_cells() << " cells, " << faceData.size()/(verticesPerFace+2) << " boundary faces with boundary or manifold ids\n";
+}
+
+#endif
@@ -17,4 +17,19 @@ void ellipticBVP<dim>::updateAfterIncrement(){
   //default method does nothing
 }
 
+//whether the converged increment is the last one. Called from updateAfterIncrement,
+//before totalLoadFactor is updated (see solve())
+template <int dim>
+bool ellipticBVP<dim>::isLastIncrement(){
+#ifdef enableAdaptiveTimeStepping
+#if enableAdaptiveTimeStepping==true
+  return (totalLoadFactor+loadFactorSetByModel>=totalNumIncrements);
+#else
+  return (currentIncrement+1>=totalIncrements);
+#endif
+#else
+  return (currentIncrement+1>=totalIncrements);
+#endif
+}
+
 #endif
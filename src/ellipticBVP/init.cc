@@ -12,16 +12,30 @@ void ellipticBVP<dim>::init(){
 	<< Utilities::MPI::n_mpi_processes(mpi_communicator)
 	<< std::endl;
 
-  //initialize FE objects
-  dofHandler.distribute_dofs (FE);
-  locally_owned_dofs = dofHandler.locally_owned_dofs ();
-  DoFTools::extract_locally_relevant_dofs (dofHandler, locally_relevant_dofs);
+  //initialize FE objects and global data structures
+  setupSystem();
   pcout << "number of elements: "
 	<< triangulation.n_global_active_cells()
 	<< std::endl
 	<< "number of degrees of freedom: " 
 	<< dofHandler.n_dofs() 
 	<< std::endl;
+  previousIncrementLoadFactor=0.0;
+
+  //apply initial conditions
+  applyInitialConditions();
+  solutionWithGhosts=solution;
+  oldSolution=solution;
+}
+
+//distribute the dofs and allocate the global data structures for the current
+//mesh and partition. Called from init() and after repartitioning
+template <int dim>
+void ellipticBVP<dim>::setupSystem(){
+  //initialize FE objects
+  dofHandler.distribute_dofs (FE);
+  locally_owned_dofs = dofHandler.locally_owned_dofs ();
+  DoFTools::extract_locally_relevant_dofs (dofHandler, locally_relevant_dofs);
 
   //initialize FE objects for scalar field which will be used for post processing
   dofHandler_Scalar.distribute_dofs (FE_Scalar);
@@ -50,19 +64,34 @@ void ellipticBVP<dim>::init(){
   solutionWithGhosts.reinit (locally_owned_dofs, locally_relevant_dofs, mpi_communicator);
   solutionIncWithGhosts.reinit (locally_owned_dofs, locally_relevant_dofs, mpi_communicator);
   residual.reinit (locally_owned_dofs, mpi_communicator); residual=0;
+  previousIncrementSolution.reinit (locally_owned_dofs, mpi_communicator); previousIncrementSolution=0;
   
-  CompressedSimpleSparsityPattern csp (locally_relevant_dofs);
-  DoFTools::make_sparsity_pattern (dofHandler, csp, constraints, false);
-  SparsityTools::distribute_sparsity_pattern (csp,
-					      dofHandler.n_locally_owned_dofs_per_processor(),
-					      mpi_communicator,
-					      locally_relevant_dofs);
-  jacobian.reinit (locally_owned_dofs, locally_owned_dofs, csp, mpi_communicator);
+  //the global jacobian and its sparsity pattern are not needed with the matrix-free tangent
+  //(serial assembly, see assemble())
+  if (matrixFreeTangent){
+    initMatrixFreeTangent();
+  }
+  else{
+    CompressedSimpleSparsityPattern csp (locally_relevant_dofs);
+    DoFTools::make_sparsity_pattern (dofHandler, csp, constraints, false);
+    SparsityTools::distribute_sparsity_pattern (csp,
+						dofHandler.n_locally_owned_dofs_per_processor(),
+						mpi_communicator,
+						locally_relevant_dofs);
+    jacobian.reinit (locally_owned_dofs, locally_owned_dofs, csp, mpi_communicator);
 
-  //apply initial conditions
-  applyInitialConditions();
-  solutionWithGhosts=solution;
-  oldSolution=solution;
+    //cell coloring and buffers for multithreaded assembly
+#ifndef enableUserModel
+    initMultithreadedAssembly(csp);
+#endif
+  }
+  //the preconditioner refers to the previous matrix
+  jacobianPreconditioner.reset();
+
+  //assembly time of the locally owned cells (load balancing, see repartition.cc)
+  if (measureCellCost){
+    cellCost.assign(triangulation.n_locally_owned_active_cells(), 0.0);
+  }
 }
 
 #endif
@@ -11,6 +11,12 @@ void ellipticBVP<dim>::updateBeforeIteration(){
   //default method does nothing
 }
 
+//method called after each assembly of the nonlinear iterations (e.g. for diagnostics of the material model)
+template <int dim>
+void ellipticBVP<dim>::updateAfterAssembly(){
+  //default method does nothing
+}
+
 //method called after each iteration
 template <int dim>
 void ellipticBVP<dim>::updateAfterIteration(){
@@ -0,0 +1,213 @@
+//matrix-free tangent operator for ellipticBVP class
+
+#ifndef MATRIXFREETANGENT_ELLIPTICBVP_H
+#define MATRIXFREETANGENT_ELLIPTICBVP_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//With enableMatrixFreeTangent the global jacobian and its sparsity pattern are
+//not allocated. The material model hands the tangent dP/dF of every quadrature
+//point to storeQuadPointTangent, where it is stored premultiplied by JxW in the
+//compact (dim*dim)x(dim*dim) layout (row dim*i+k, column dim*j+l), in double
+//precision (exact Newton jacobian) or, with matrixFreeTangentSinglePrecision,
+//in single precision (inexact Newton jacobian).
+//
+//This mode does not reduce the memory for Q1 hexes with 8 quadrature points:
+//81 doubles per quadrature point are 5184 bytes per cell against about 2900
+//bytes of values and column indices per cell of the assembled matrix. In single
+//precision (2592 bytes per cell) it is about 10% below the assembled matrix.
+//What it saves is the sparsity pattern and the PETSc matrix assembly. Sum
+//factorization does not pay off for Q1 elements and is not used.
+//
+//The Krylov solver (the deal.II counterpart of linearSolverType) applies the
+//jacobian cell by cell (applyTangent): displacement gradient of the cell
+//values, tangent times gradient, and test with the shape gradients, with the
+//hanging node and Dirichlet constraints applied on the fly. The diagonal of the
+//elemental jacobians is assembled alongside for the preconditioner: "jacobi",
+//or "chebyshev", a Chebyshev iteration of degree matrixFreeChebyshevDegree
+//around the Jacobi preconditioner (the spectrum is estimated by a few CG
+//iterations). The preconditioners built from the matrix (block Jacobi, SOR,
+//SSOR, BoomerAMG) are not available, and a geometric multigrid would need the
+//constitutive state on the coarse levels. Only material models that set
+//matrixFreeTangentSupported store the tangents, for the others the jacobian is
+//assembled (see run()).
+
+//deal.II Krylov solver of matrix-free mode for the PETSc solver selected by linearSolverType
+template <class PETScSolverType, class VectorType> struct matrixFreeSolver;
+template <class VectorType> struct matrixFreeSolver<PETScWrappers::SolverCG, VectorType> {typedef SolverCG<VectorType> type;};
+template <class VectorType> struct matrixFreeSolver<PETScWrappers::SolverGMRES, VectorType> {typedef SolverGMRES<VectorType> type;};
+template <class VectorType> struct matrixFreeSolver<PETScWrappers::SolverBicgstab, VectorType> {typedef SolverBicgstab<VectorType> type;};
+template <class VectorType> struct matrixFreeSolver<PETScWrappers::SolverMinRes, VectorType> {typedef SolverMinRes<VectorType> type;};
+
+//dP_{ik}=C_{ik,jl}*u_{j,l} with the stored tangent C of a quadrature point
+template <int dim, typename Number>
+inline void contractTangent(const Number* C, const double* gradU, double* stress){
+  for (unsigned int ik=0; ik<dim*dim; ++ik){
+    double sum=0.0;
+    for (unsigned int jl=0; jl<dim*dim; ++jl) sum+=C[ik*dim*dim+jl]*gradU[jl];
+    stress[ik]=sum;
+  }
+}
+
+//allocate the tangent storage. Called from setupSystem()
+template <int dim>
+void ellipticBVP<dim>::initMatrixFreeTangent(){
+  QGauss<dim>  quadrature(quadOrder);
+  const unsigned int numCells=triangulation.n_locally_owned_active_cells();
+  const std::size_t tangentEntries=(std::size_t) numCells*quadrature.size()*dim*dim*dim*dim;
+  double localMemory=0.0;
+  if (matrixFreeSinglePrecision){
+    quadPointTangentsSingle.assign(tangentEntries, 0.0f);
+    localMemory=tangentEntries*sizeof(float);
+  }
+  else{
+    quadPointTangents.assign(tangentEntries, 0.0);
+    localMemory=tangentEntries*sizeof(double);
+  }
+  inverseTangentDiagonal.reinit (locally_owned_dofs, mpi_communicator);
+  tangentSrcGhosts.reinit (locally_owned_dofs, locally_relevant_dofs, mpi_communicator);
+  const double memory=Utilities::MPI::sum(localMemory, mpi_communicator);
+  char buffer[200];
+  sprintf(buffer, "matrix-free tangent: %8.2f MB of quadrature point tangents (%s precision)\n", memory/(1024.0*1024.0), matrixFreeSinglePrecision ? "single" : "double");
+  pcout << buffer;
+}
+
+//store dP/dF*JxW of the quadrature point q of a cell. Called by the material models from getElementalValues,
+//concurrently with the multithreaded assembly: every cell writes only its own slots
+template <int dim>
+void ellipticBVP<dim>::storeQuadPointTangent(const unsigned int cellID, const unsigned int q, const FullMatrix<double>& dP_dF, const double JxW){
+  const unsigned int tangentSize=dim*dim*dim*dim;
+  //(QGauss<dim>(quadOrder) has quadOrder^dim points)
+  const unsigned int num_quad_points=Utilities::fixed_power<dim>((unsigned int) quadOrder);
+  AssertIndexRange(q, num_quad_points);
+  const std::size_t offset=((std::size_t) cellID*num_quad_points+q)*tangentSize;
+  for (unsigned int ik=0; ik<dim*dim; ++ik){
+    for (unsigned int jl=0; jl<dim*dim; ++jl){
+      if (matrixFreeSinglePrecision) quadPointTangentsSingle[offset+ik*dim*dim+jl]=(float) (dP_dF(ik,jl)*JxW);
+      else quadPointTangents[offset+ik*dim*dim+jl]=dP_dF(ik,jl)*JxW;
+    }
+  }
+}
+
+//assemble the residual and the diagonal of the elemental jacobian of a cell
+template <int dim>
+void ellipticBVP<dim>::storeElementalTangent(const FullMatrix<double>& elementalJacobian, const Vector<double>& elementalResidual, const std::vector<types::global_dof_index>& local_dof_indices){
+  const unsigned int dofs_per_cell=local_dof_indices.size();
+  Vector<double> elementalDiagonal(dofs_per_cell);
+  for (unsigned int i=0; i<dofs_per_cell; ++i){
+    elementalDiagonal(i)=elementalJacobian(i,i);
+  }
+  //the elemental jacobian accounts for the inhomogeneities in the residual
+  constraints.distribute_local_to_global(elementalResidual, local_dof_indices, residual, elementalJacobian);
+  constraints.distribute_local_to_global(elementalDiagonal, local_dof_indices, inverseTangentDiagonal);
+}
+
+//invert the assembled diagonal. The rows of constrained dofs are identity rows of the operator
+template <int dim>
+void ellipticBVP<dim>::finalizeMatrixFreeTangent(){
+  inverseTangentDiagonal.compress(VectorOperation::add);
+  constrainedOwnedDofs.clear();
+  for (IndexSet::ElementIterator it=locally_owned_dofs.begin(); it!=locally_owned_dofs.end(); ++it){
+    if (constraints.is_constrained(*it)) constrainedOwnedDofs.push_back(*it);
+  }
+  for (unsigned int i=0; i<constrainedOwnedDofs.size(); ++i){
+    inverseTangentDiagonal(constrainedOwnedDofs[i])=1.0;
+  }
+  inverseTangentDiagonal.compress(VectorOperation::insert);
+  PetscErrorCode ierr=VecReciprocal(inverseTangentDiagonal);
+  AssertThrow(ierr==0, ExcMessage("VecReciprocal failed for the tangent diagonal"));
+}
+
+//dst=K*src with the homogeneous constraints
+template <int dim>
+void ellipticBVP<dim>::applyTangent(vectorType& dst, const vectorType& src) const{
+  QGauss<dim>  quadrature(quadOrder);
+  FEValues<dim> fe_values (FE, quadrature, update_gradients);
+  const unsigned int dofs_per_cell=FE.dofs_per_cell;
+  const unsigned int num_quad_points=quadrature.size();
+  const unsigned int tangentSize=dim*dim*dim*dim;
+  tangentSrcGhosts=src;
+  dst=0.0;
+  std::vector<types::global_dof_index> local_dof_indices (dofs_per_cell);
+  std::vector<unsigned int> component (dofs_per_cell);
+  for (unsigned int d=0; d<dofs_per_cell; ++d) component[d]=FE.system_to_component_index(d).first;
+  Vector<double> srcLocal(dofs_per_cell), dstLocal(dofs_per_cell);
+  double gradU[dim*dim], stress[dim*dim];
+  typename DoFHandler<dim>::active_cell_iterator cell = dofHandler.begin_active(), endc = dofHandler.end();
+  for (; cell!=endc; ++cell) {
+    if (!cell->is_locally_owned()) continue;
+    fe_values.reinit (cell);
+    cell->get_dof_indices (local_dof_indices);
+    //gather, constrained values from their masters (zero for Dirichlet dofs)
+    for (unsigned int i=0; i<dofs_per_cell; ++i){
+      const types::global_dof_index globalDOF=local_dof_indices[i];
+      if (constraints.is_constrained(globalDOF)){
+	srcLocal(i)=0.0;
+	const std::vector<std::pair<types::global_dof_index,double> >* entries=constraints.get_constraint_entries(globalDOF);
+	for (unsigned int k=0; k<entries->size(); ++k){
+	  srcLocal(i)+=(*entries)[k].second*tangentSrcGhosts((*entries)[k].first);
+	}
+      }
+      else{
+	srcLocal(i)=tangentSrcGhosts(globalDOF);
+      }
+    }
+    //elemental product, summed over the quadrature points (the user index is the cellID of the last assembly)
+    dstLocal=0.0;
+    const std::size_t offset=(std::size_t) cell->user_index()*num_quad_points*tangentSize;
+    for (unsigned int q=0; q<num_quad_points; ++q){
+      //displacement gradient u_{j,l}
+      for (unsigned int jl=0; jl<dim*dim; ++jl) gradU[jl]=0.0;
+      for (unsigned int d=0; d<dofs_per_cell; ++d){
+	const Tensor<1,dim>& grad=fe_values.shape_grad(d, q);
+	for (unsigned int l=0; l<dim; ++l) gradU[dim*component[d]+l]+=srcLocal(d)*grad[l];
+      }
+      //stress increment dP_{ik}=C_{ik,jl}*u_{j,l}*JxW
+      if (matrixFreeSinglePrecision) contractTangent<dim>(&quadPointTangentsSingle[offset+q*tangentSize], gradU, stress);
+      else contractTangent<dim>(&quadPointTangents[offset+q*tangentSize], gradU, stress);
+      //test with the shape gradients, N_{d,k}*dP_{ik}
+      for (unsigned int d=0; d<dofs_per_cell; ++d){
+	const Tensor<1,dim>& grad=fe_values.shape_grad(d, q);
+	for (unsigned int k=0; k<dim; ++k) dstLocal(d)+=grad[k]*stress[dim*component[d]+k];
+      }
+    }
+    //scatter (transpose of the constraints)
+    constraints.distribute_local_to_global(dstLocal, local_dof_indices, dst);
+  }
+  dst.compress(VectorOperation::add);
+  //identity rows of the constrained dofs
+  for (unsigned int i=0; i<constrainedOwnedDofs.size(); ++i){
+    dst(constrainedOwnedDofs[i])=src(constrainedOwnedDofs[i]);
+  }
+  dst.compress(VectorOperation::insert);
+}
+
+//solve the jacobian system in matrix-free mode with the deal.II counterpart of linearSolverType
+template <int dim>
+void ellipticBVP<dim>::solveMatrixFree(vectorType& x, const vectorType& b, SolverControl& solver_control){
+#ifdef linearSolverType
+  typename matrixFreeSolver<linearSolverType, vectorType>::type solver(solver_control);
+  const tangentOperator A(*this);
+  if (linearPreconditioner=="chebyshev"){
+    //Chebyshev iteration around the Jacobi preconditioner
+    typedef PreconditionChebyshev<tangentOperator, vectorType> chebyshevType;
+    typename chebyshevType::AdditionalData additionalData;
+#ifdef matrixFreeChebyshevDegree
+    additionalData.degree=matrixFreeChebyshevDegree;
+#else
+    additionalData.degree=4;
+#endif
+    additionalData.smoothing_range=20.0;
+    additionalData.eig_cg_n_iterations=10;
+    additionalData.matrix_diagonal_inverse=inverseTangentDiagonal;
+    chebyshevType chebyshev;
+    chebyshev.initialize(A, additionalData);
+    solver.solve (A, x, b, chebyshev);
+  }
+  else{
+    solver.solve (A, x, b, tangentPreconditioner(inverseTangentDiagonal));
+  }
+#endif
+}
+
+#endif
@@ -5,9 +5,24 @@
 //this source file is temporarily treated as a header file (hence
 //#ifndef's) till library packaging scheme is finalized
 
-//output results
+//output results. With outputFileType "pvtu" every MPI process writes its own
+//vtu files and processor 0 the pvtu records. With "vtu" and "hdf5" the
+//displacement and the projected fields are written collectively into a single
+//file per increment (MPI-IO), which keeps the number of files independent of
+//the number of processes
 template <int dim>
 void ellipticBVP<dim>::output(){
+  if ((outputFormat!="pvtu") && (outputFormat!="vtu") && (outputFormat!="hdf5")){
+    pcout << "\nError: unknown outputFileType " << outputFormat << ". Use \"pvtu\", \"vtu\" or \"hdf5\".\n\n";
+    exit (-1);
+  }
+#ifndef DEAL_II_WITH_HDF5
+  if (outputFormat=="hdf5"){
+    pcout << "\nError: outputFileType \"hdf5\" requires deal.II configured with HDF5. Use \"vtu\" instead.\n\n";
+    exit (-1);
+  }
+#endif
+  const bool singleFile=(outputFormat!="pvtu");
   DataOut<dim> data_out, data_out_Scalar;
   data_out.attach_dof_handler (dofHandler);
   data_out_Scalar.attach_dof_handler (dofHandler_Scalar);
@@ -59,8 +74,14 @@ void ellipticBVP<dim>::output(){
 #endif
 #endif
     //
-    data_out_Scalar.add_data_vector (*postFieldsWithGhosts[field], 
-				     postprocessed_solution_names[field].c_str());
+    if (singleFile){
+      data_out.add_data_vector (dofHandler_Scalar, *postFieldsWithGhosts[field], 
+				postprocessed_solution_names[field]);
+    }
+    else{
+      data_out_Scalar.add_data_vector (*postFieldsWithGhosts[field], 
+				       postprocessed_solution_names[field].c_str());
+    }
     numPostProcessedFieldsWritten++;
   }
   
@@ -70,7 +91,7 @@ void ellipticBVP<dim>::output(){
     subdomain(i) = triangulation.locally_owned_subdomain();
   data_out.add_data_vector (subdomain, "subdomain");
   data_out.build_patches ();
-  if (numPostProcessedFieldsWritten>0){
+  if (!singleFile && (numPostProcessedFieldsWritten>0)){
     data_out_Scalar.add_data_vector (subdomain, "subdomain");
     data_out_Scalar.build_patches ();
   }
@@ -86,7 +107,7 @@ void ellipticBVP<dim>::output(){
   }
   data_out.add_data_vector (material, "meshGrain_ID");
   data_out.build_patches ();
-  if (numPostProcessedFieldsWritten>0){
+  if (!singleFile && (numPostProcessedFieldsWritten>0)){
     data_out_Scalar.add_data_vector (material, "meshGrain_ID");
     data_out_Scalar.build_patches ();
   }
@@ -104,7 +125,32 @@ void ellipticBVP<dim>::output(){
   //
   unsigned int incrementDigits= (totalIncrements<10000 ? 4 : std::ceil(std::log10(totalIncrements))+1);
   unsigned int domainDigits   = (Utilities::MPI::n_mpi_processes(mpi_communicator)<10000 ? 4 : std::ceil(std::log10(Utilities::MPI::n_mpi_processes(mpi_communicator)))+1);
-  
+
+  //single file written collectively by all processes
+  if (outputFormat=="vtu"){
+    const std::string filename = (dir+"solution-" +
+				  Utilities::int_to_string (currentIncrement,incrementDigits) +
+				  ".vtu");
+    data_out.write_vtu_in_parallel (filename.c_str(), mpi_communicator);
+    pcout << "output written to: " << filename.c_str() << " \n\n";
+    return;
+  }
+#ifdef DEAL_II_WITH_HDF5
+  if (outputFormat=="hdf5"){
+    //the xdmf record lists the hdf5 files of all increments written so far
+    const std::string filename = ("solution-" +
+				  Utilities::int_to_string (currentIncrement,incrementDigits) +
+				  ".h5");
+    DataOutBase::DataOutFilter dataFilter (DataOutBase::DataOutFilterFlags (true, true));
+    data_out.write_filtered_data (dataFilter);
+    data_out.write_hdf5_parallel (dataFilter, dir+filename, mpi_communicator);
+    xdmfEntries.push_back (data_out.create_xdmf_entry (dataFilter, filename, totalLoadFactor, mpi_communicator));
+    data_out.write_xdmf_file (xdmfEntries, dir+"solution.xdmf", mpi_communicator);
+    pcout << "output written to: " << (dir+filename).c_str() << " \n\n";
+    return;
+  }
+#endif
+
   const std::string filename = (dir+"solution-" +
 				Utilities::int_to_string (currentIncrement,incrementDigits) +
 				"." +
@@ -0,0 +1,134 @@
+//preconditioner of the displacement solve for ellipticBVP class
+
+#ifndef PRECONDITIONER_ELLIPTICBVP_H
+#define PRECONDITIONER_ELLIPTICBVP_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//attach the rigid body modes (near nullspace of the elasticity operator),
+//computed from the support points of the locally owned dofs, to the matrix A
+template <int dim>
+void ellipticBVP<dim>::setRigidBodyModes(matrixType& A){
+  const unsigned int numModes=(dim==3) ? 6 : 3;
+  std::vector<vectorType> modes(numModes);
+  for (unsigned int m=0; m<numModes; m++){
+    modes[m].reinit (locally_owned_dofs, mpi_communicator); modes[m]=0;
+  }
+
+  //translations and rotations (e_k x X) evaluated at the nodes
+  const unsigned int   dofs_per_cell   = FE.dofs_per_cell;
+  std::vector<types::global_dof_index> local_dof_indices (dofs_per_cell);
+  typename DoFHandler<dim>::active_cell_iterator cell = dofHandler.begin_active(), endc = dofHandler.end();
+  for (; cell!=endc; ++cell) {
+    if (cell->is_locally_owned()){
+      cell->get_dof_indices (local_dof_indices);
+      for (unsigned int i=0; i<dofs_per_cell; ++i) {
+	const unsigned int globalDOF=local_dof_indices[i];
+	if (!locally_owned_dofs.is_element(globalDOF)) continue;
+	const unsigned int dof = FE.system_to_component_index(i).first;
+	const Point<dim> node=supportPoints[globalDOF];
+	modes[dof](globalDOF)=1.0;
+	if (dim==3){
+	  if (dof==0) {modes[4](globalDOF)=node[2];  modes[5](globalDOF)=-node[1];}
+	  if (dof==1) {modes[3](globalDOF)=-node[2]; modes[5](globalDOF)=node[0];}
+	  if (dof==2) {modes[3](globalDOF)=node[1];  modes[4](globalDOF)=-node[0];}
+	}
+	else{
+	  if (dof==0) modes[2](globalDOF)=-node[1];
+	  if (dof==1) modes[2](globalDOF)=node[0];
+	}
+      }
+    }
+  }
+
+  //PETSc expects an orthonormal basis (modified Gram-Schmidt)
+  for (unsigned int m=0; m<numModes; m++){
+    modes[m].compress(VectorOperation::insert);
+    for (unsigned int k=0; k<m; k++){
+      modes[m].add(-(modes[m]*modes[k]), modes[k]);
+    }
+    modes[m]/=modes[m].l2_norm();
+  }
+
+  std::vector<Vec> vecs(numModes);
+  for (unsigned int m=0; m<numModes; m++) vecs[m]=modes[m];
+  MatNullSpace nearNullSpace;
+  PetscErrorCode ierr=MatNullSpaceCreate(mpi_communicator, PETSC_FALSE, numModes, &vecs[0], &nearNullSpace);
+  AssertThrow(ierr==0, ExcMessage("MatNullSpaceCreate failed for the rigid body modes"));
+  ierr=MatSetNearNullSpace(A, nearNullSpace);
+  AssertThrow(ierr==0, ExcMessage("MatSetNearNullSpace failed for the rigid body modes"));
+  ierr=MatNullSpaceDestroy(&nearNullSpace);
+  AssertThrow(ierr==0, ExcMessage("MatNullSpaceDestroy failed for the rigid body modes"));
+}
+
+//Krylov solvers of linearSolverType that need a symmetric preconditioner
+template <class SolverType> struct symmetricKrylovSolver {static const bool value=false;};
+template <> struct symmetricKrylovSolver<PETScWrappers::SolverCG> {static const bool value=true;};
+template <> struct symmetricKrylovSolver<PETScWrappers::SolverCR> {static const bool value=true;};
+template <> struct symmetricKrylovSolver<PETScWrappers::SolverMinRes> {static const bool value=true;};
+
+//build the preconditioner of the jacobian selected by preconditionerType. The
+//BoomerAMG hierarchy is built in the first nonlinear iteration of an increment
+//and reused in the following ones (same sparsity pattern, only the values change).
+//The other preconditioners are cheap to set up and are rebuilt for every solve.
+//With reusePreconditioner any preconditioner is kept across nonlinear iterations
+//and increments, until a solve needs more than preconditionerRebuildIterations iterations
+template <int dim>
+void ellipticBVP<dim>::buildPreconditioner(matrixType& A){
+  bool reuse=(linearPreconditioner=="boomerAMG") && (jacobianPreconditionerIncrement==currentIncrement);
+#ifdef reusePreconditioner
+  if (reusePreconditioner) reuse=!rebuildPreconditioner;
+#endif
+  if (jacobianPreconditioner && reuse) return;
+
+  //(the "preconditioner setup" timer section counts the setups)
+  computing_timer.enter_section("preconditioner setup");
+  jacobianPreconditioner.reset();
+  rebuildPreconditioner=false;
+  if (linearPreconditioner=="jacobi"){
+    jacobianPreconditioner.reset(new PETScWrappers::PreconditionJacobi(A));
+  }
+  else if ((linearPreconditioner=="blockJacobi") || (linearPreconditioner=="sor")){
+    //not symmetric, CG and MINRES need a symmetric preconditioner
+#ifdef linearSolverType
+    if (symmetricKrylovSolver<linearSolverType>::value){
+      pcout << "\nError: preconditionerType " << linearPreconditioner << " is not symmetric. Use it with PETScWrappers::SolverGMRES or PETScWrappers::SolverBicgstab, or use \"jacobi\", \"ssor\" or \"boomerAMG\" with PETScWrappers::SolverCG.\n\n";
+      exit (-1);
+    }
+#endif
+    //block Jacobi: one block per MPI process, ILU(0) within the blocks
+    if (linearPreconditioner=="blockJacobi") jacobianPreconditioner.reset(new PETScWrappers::PreconditionBlockJacobi(A));
+    else jacobianPreconditioner.reset(new PETScWrappers::PreconditionSOR(A));
+  }
+  else if (linearPreconditioner=="ssor"){
+    jacobianPreconditioner.reset(new PETScWrappers::PreconditionSSOR(A));
+  }
+  else if (linearPreconditioner=="boomerAMG"){
+    setRigidBodyModes(A);
+    PETScWrappers::PreconditionBoomerAMG::AdditionalData additionalData;
+    additionalData.symmetric_operator=true;
+    additionalData.strong_threshold=0.5; //recommended for 3D problems
+    jacobianPreconditioner.reset(new PETScWrappers::PreconditionBoomerAMG(A, additionalData));
+  }
+  else{
+    pcout << "\nError: unknown preconditionerType " << linearPreconditioner << ". Use \"jacobi\", \"blockJacobi\", \"sor\", \"ssor\" or \"boomerAMG\" (\"chebyshev\" only with the matrix-free tangent).\n\n";
+    exit (-1);
+  }
+#if DEAL_II_PETSC_VERSION_GTE(3,5,0)
+  //keep the setup when the values of A change in the following iterations
+  //(otherwise PETSc sets the preconditioner up again in every solve)
+  bool keepSetup=(linearPreconditioner=="boomerAMG");
+#ifdef reusePreconditioner
+  keepSetup=keepSetup || reusePreconditioner;
+#endif
+  if (keepSetup){
+    PetscErrorCode ierr=PCSetReusePreconditioner(jacobianPreconditioner->get_pc(), PETSC_TRUE);
+    AssertThrow(ierr==0, ExcMessage("PCSetReusePreconditioner failed"));
+  }
+#endif
+  jacobianPreconditionerIncrement=currentIncrement;
+  numPreconditionerSetups++;
+  computing_timer.exit_section("preconditioner setup");
+}
+
+#endif
@@ -11,6 +11,15 @@ void ellipticBVP<dim>::initProject(){
   //return if no post processing fields
   if (numPostProcessedFields==0) return;
 
+  //release the vectors of a previous partition (initProject is called again after repartitioning)
+  for (unsigned int field=0; field<postFields.size(); field++){
+    delete postResidual[field];
+    delete postFields[field];
+    delete postFieldsWithGhosts[field];
+  }
+  postResidual.clear(); postFields.clear(); postFieldsWithGhosts.clear();
+  massMatrixPreconditioner.reset();
+
   //create and initialize post processing field vectors
   for (unsigned int field=0; field<numPostProcessedFields; field++){
     //residuals
@@ -35,19 +44,31 @@ void ellipticBVP<dim>::initProject(){
   const unsigned int num_local_cells = triangulation.n_locally_owned_active_cells();
   postprocessValues.reinit(TableIndices<4>(num_local_cells, num_quad_points, numPostProcessedFields, dim));
 
-  //create mass matrix
-  CompressedSimpleSparsityPattern csp (locally_relevant_dofs_Scalar);
-  DoFTools::make_sparsity_pattern (dofHandler_Scalar, csp, constraintsMassMatrix, false);
-  SparsityTools::distribute_sparsity_pattern (csp,
-					      dofHandler_Scalar.n_locally_owned_dofs_per_processor(),
-					      mpi_communicator,
-					      locally_relevant_dofs_Scalar);
-  massMatrix.reinit (locally_owned_dofs_Scalar, locally_owned_dofs_Scalar, csp, mpi_communicator); massMatrix=0.0;
+  //"l2": projection with the consistent mass matrix, "lumped": row sum lumped mass matrix (no linear solve)
+  if ((projectionMethod!="l2") && (projectionMethod!="lumped")){
+    pcout << "\nError: unknown projectionType " << projectionMethod << ". Use \"l2\" or \"lumped\".\n\n";
+    exit (-1);
+  }
+
+  //create mass matrix (or the lumped mass vector)
+  if (projectionMethod=="l2"){
+    CompressedSimpleSparsityPattern csp (locally_relevant_dofs_Scalar);
+    DoFTools::make_sparsity_pattern (dofHandler_Scalar, csp, constraintsMassMatrix, false);
+    SparsityTools::distribute_sparsity_pattern (csp,
+						dofHandler_Scalar.n_locally_owned_dofs_per_processor(),
+						mpi_communicator,
+						locally_relevant_dofs_Scalar);
+    massMatrix.reinit (locally_owned_dofs_Scalar, locally_owned_dofs_Scalar, csp, mpi_communicator); massMatrix=0.0;
+  }
+  else{
+    invLumpedMass.reinit (locally_owned_dofs_Scalar, mpi_communicator); invLumpedMass=0.0;
+  }
 
   //local variables
   FEValues<dim> fe_values (FE_Scalar, quadrature, update_values | update_JxW_values);
   const unsigned int   dofs_per_cell   = FE_Scalar.dofs_per_cell;
   FullMatrix<double>   elementalMass(dofs_per_cell, dofs_per_cell);
+  Vector<double>       elementalLumpedMass(dofs_per_cell);
   std::vector<types::global_dof_index> local_dof_indices (dofs_per_cell);
   
   //parallel loop over all elements
@@ -81,11 +102,33 @@ void ellipticBVP<dim>::initProject(){
       
       //assemble
       cell->get_dof_indices (local_dof_indices);
-      constraintsMassMatrix.distribute_local_to_global(elementalMass, local_dof_indices, massMatrix);
+      if (projectionMethod=="l2"){
+	constraintsMassMatrix.distribute_local_to_global(elementalMass, local_dof_indices, massMatrix);
+      }
+      else{
+	//row sums of the elemental mass matrix
+	for (unsigned int d1=0; d1<dofs_per_cell; ++d1) {
+	  elementalLumpedMass(d1)=0.0;
+	  for (unsigned int d2=0; d2<dofs_per_cell; ++d2) {
+	    elementalLumpedMass(d1)+=elementalMass(d1,d2);
+	  }
+	}
+	constraintsMassMatrix.distribute_local_to_global(elementalLumpedMass, local_dof_indices, invLumpedMass);
+      }
     }
   }
   //MPI operation to sync data 
-  massMatrix.compress(VectorOperation::add);
+  if (projectionMethod=="l2"){
+    massMatrix.compress(VectorOperation::add);
+    //the mass matrix does not change, so its preconditioner is set up once for all fields and increments
+    massMatrixPreconditioner.reset(new PETScWrappers::PreconditionJacobi(massMatrix));
+  }
+  else{
+    invLumpedMass.compress(VectorOperation::add);
+    //entries of constrained (hanging) nodes are zero and stay zero
+    PetscErrorCode ierr=VecReciprocal(invLumpedMass);
+    AssertThrow(ierr==0, ExcMessage("VecReciprocal failed for the lumped mass matrix"));
+  }
 }
 
 //post processed field projection operation
@@ -155,9 +198,18 @@ void ellipticBVP<dim>::project(){
   for (unsigned int field=0; field<numPostProcessedFields; field++){
     postResidual[field]->compress(VectorOperation::add);
     
-    //L2 projection by solving for Mx=b problem
-    *postFields[field]=0.0;
-    solveLinearSystem2(constraintsMassMatrix, massMatrix, *postResidual[field], *postFields[field],  *postFieldsWithGhosts[field],  *postFieldsWithGhosts[field]);
+    if (projectionMethod=="l2"){
+      //L2 projection by solving for Mx=b problem
+      *postFields[field]=0.0;
+      solveLinearSystem2(constraintsMassMatrix, massMatrix, *postResidual[field], *postFields[field],  *postFieldsWithGhosts[field],  *postFieldsWithGhosts[field]);
+    }
+    else{
+      //lumped projection x=M_L^-1 b, hanging nodes are interpolated from their masters
+      *postFields[field]=*postResidual[field];
+      postFields[field]->scale(invLumpedMass);
+      constraintsMassMatrix.distribute(*postFields[field]);
+      *postFieldsWithGhosts[field]=*postFields[field];
+    }
   }
 }
 
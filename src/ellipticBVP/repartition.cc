@@ -0,0 +1,288 @@
+//mesh refinement and load balancing methods for ellipticBVP class
+
+#ifndef REPARTITION_ELLIPTICBVP_H
+#define REPARTITION_ELLIPTICBVP_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//The history of the material model is indexed by cellID's, the position of the
+//cell among the locally owned cells. Any change of the triangulation
+//(refinement, coarsening, repartitioning) is therefore done by updateMesh,
+//which attaches the history to the p4est cells before the change and reads it
+//back afterwards: the values of every quadrature point (packHistoryData) and
+//the values of every cell (packCellHistoryData). Refined cells take, at each of
+//their quadrature points, the values of the nearest quadrature point of the
+//parent, and coarsened cells the values of the nearest quadrature point of the
+//child containing it. Cell values are only kept by cells that are neither
+//refined nor coarsened. The displacements are transferred with a SolutionTransfer.
+//
+//Load balancing: the initial partition is by cell count, while the cost of the
+//constitutive update differs strongly between cells (e.g. elastic and plastic
+//grains). During assembly the time spent in the material model is accumulated
+//per cell (cellCost). Every loadBalanceInterval increments, balanceLoad compares
+//the assembly time of the processes and, if the slowest one exceeds the mean by
+//more than loadImbalanceTolerance, the mesh is repartitioned by p4est with the
+//measured cost as cell weights.
+
+//compare the assembly time of the processes and repartition the mesh if needed
+template <int dim>
+void ellipticBVP<dim>::balanceLoad(){
+  if (!repartitionSupported){
+    pcout << "load balancing not supported by this material model\n";
+    return;
+  }
+  double localCost=0.0;
+  for (unsigned int i=0; i<cellCost.size(); i++) localCost+=cellCost[i];
+  const double maxCost=Utilities::MPI::max(localCost, mpi_communicator);
+  const double totalCost=Utilities::MPI::sum(localCost, mpi_communicator);
+  const double meanCost=totalCost/Utilities::MPI::n_mpi_processes(mpi_communicator);
+  if (meanCost<=0.0) return;
+  char buffer[200];
+  sprintf(buffer, "constitutive assembly time per process: max %10.4e s, mean %10.4e s, imbalance %6.3f\n", maxCost, meanCost, maxCost/meanCost);
+  pcout << buffer;
+
+#ifdef loadImbalanceTolerance
+  const double tolerance=loadImbalanceTolerance;
+#else
+  const double tolerance=1.1;
+#endif
+  if (maxCost>tolerance*meanCost){
+    meanCellCost=totalCost/triangulation.n_global_active_cells();
+    updateMesh(true);
+  }
+  //start measuring again
+  std::fill(cellCost.begin(), cellCost.end(), 0.0);
+}
+
+//execute the refinement and coarsening flags set on the triangulation (if any) and
+//repartition the mesh, weighted by the measured cell costs if useCellWeights.
+//Called between increments, once the history of the material model has been converged
+template <int dim>
+void ellipticBVP<dim>::updateMesh(const bool useCellWeights){
+  AssertThrow(repartitionSupported, ExcMessage("the material model does not support the transfer of its history to a new mesh"));
+
+  //the history of the material model is indexed by the cellID's of the current mesh
+  typename DoFHandler<dim>::active_cell_iterator cell = dofHandler.begin_active(), endc = dofHandler.end();
+  unsigned int cellID=0;
+  for (; cell!=endc; ++cell) {
+    if (cell->is_locally_owned()) cell->set_user_index(cellID++);
+  }
+
+  //displacements (converged solution and last solution increment, the warm start of the next increment)
+  vectorType previousIncrementSolutionWithGhosts(locally_owned_dofs, locally_relevant_dofs, mpi_communicator);
+  previousIncrementSolutionWithGhosts=previousIncrementSolution;
+  solutionWithGhosts=solution;
+  std::vector<const vectorType*> oldVectors(2);
+  oldVectors[0]=&solutionWithGhosts;
+  oldVectors[1]=&previousIncrementSolutionWithGhosts;
+  parallel::distributed::SolutionTransfer<dim, vectorType> solutionTransfer(dofHandler);
+  triangulation.prepare_coarsening_and_refinement();
+  solutionTransfer.prepare_for_coarsening_and_refinement(oldVectors);
+
+  //history, a fixed number of doubles per cell: the cell values followed by the values of the quadrature points
+  initQuadPointTransfer();
+  const unsigned int transferSize=cellHistoryDataSize()+parentQuadPoint[0].size()*historyDataSize();
+  unsigned int transferOffset=0;
+  if (transferSize>0){
+    transferOffset=triangulation.register_data_attach(transferSize*sizeof(double),
+						      std_cxx11::bind(&ellipticBVP<dim>::packTransferData, this, std_cxx11::_1, std_cxx11::_2, std_cxx11::_3));
+  }
+
+  //refine/coarsen and repartition
+  boost::signals2::connection weightConnection;
+  if (useCellWeights){
+    weightConnection=triangulation.signals.cell_weight.connect(std_cxx11::bind(&ellipticBVP<dim>::cellWeight, this, std_cxx11::_1, std_cxx11::_2));
+  }
+  triangulation.execute_coarsening_and_refinement();
+  weightConnection.disconnect();
+
+  //data structures of the new mesh and the transferred displacements
+  setupSystem();
+  std::vector<vectorType*> newVectors(2);
+  newVectors[0]=&solution;
+  newVectors[1]=&previousIncrementSolution;
+  solutionTransfer.interpolate(newVectors);
+  constraints.distribute(solution);
+  constraints.distribute(previousIncrementSolution);
+  oldSolution=solution;
+  solutionWithGhosts=solution;
+
+  //cellID's of the new mesh and the transferred history
+  cellID=0;
+  for (cell = dofHandler.begin_active(), endc = dofHandler.end(); cell!=endc; ++cell) {
+    if (cell->is_locally_owned()) cell->set_user_index(cellID++);
+  }
+  reinitHistoryData(cellID);
+  if (transferSize>0){
+    triangulation.notify_ready_to_unpack(transferOffset,
+					 std_cxx11::bind(&ellipticBVP<dim>::unpackTransferData, this, std_cxx11::_1, std_cxx11::_2, std_cxx11::_3));
+  }
+  updateAfterMeshChange();
+  //projection of the post-processed fields
+  initProject();
+
+  const unsigned int numLocalCells=triangulation.n_locally_owned_active_cells();
+  char buffer[200];
+  sprintf(buffer, "new mesh: %u elements, %u dofs, %u to %u elements per process\n",
+	  (unsigned int) triangulation.n_global_active_cells(), (unsigned int) dofHandler.n_dofs(),
+	  Utilities::MPI::min(numLocalCells, mpi_communicator), Utilities::MPI::max(numLocalCells, mpi_communicator));
+  pcout << buffer;
+}
+
+//maps between the quadrature points of a cell and of its children (isotropic refinement):
+//the nearest quadrature point of the parent for every quadrature point of a child, and the
+//child containing a quadrature point of the parent together with its nearest quadrature point
+template <int dim>
+void ellipticBVP<dim>::initQuadPointTransfer(){
+  const QGauss<dim> quadrature(quadOrder);
+  const unsigned int num_quad_points=quadrature.size();
+  parentQuadPoint.assign(GeometryInfo<dim>::max_children_per_cell, std::vector<unsigned int>(num_quad_points));
+  childQuadPoint.resize(num_quad_points);
+  for (unsigned int child=0; child<GeometryInfo<dim>::max_children_per_cell; child++){
+    for (unsigned int q=0; q<num_quad_points; q++){
+      const Point<dim> p=GeometryInfo<dim>::child_to_cell_coordinates(quadrature.point(q), child);
+      for (unsigned int k=0; k<num_quad_points; k++){
+	if (p.distance(quadrature.point(k))<p.distance(quadrature.point(parentQuadPoint[child][q]))) parentQuadPoint[child][q]=k;
+      }
+    }
+  }
+  for (unsigned int q=0; q<num_quad_points; q++){
+    const unsigned int child=GeometryInfo<dim>::child_cell_from_point(quadrature.point(q));
+    const Point<dim> p=GeometryInfo<dim>::cell_to_child_coordinates(quadrature.point(q), child);
+    childQuadPoint[q]=std::make_pair(child, 0u);
+    for (unsigned int k=0; k<num_quad_points; k++){
+      if (p.distance(quadrature.point(k))<p.distance(quadrature.point(childQuadPoint[q].second))) childQuadPoint[q].second=k;
+    }
+  }
+}
+
+//weight of a cell in the repartitioning. p4est adds a base weight of 1000 to every
+//cell, which accounts for the work that does not depend on the material state
+//(scatter, linear solve). The measured constitutive cost is added relative to the
+//mean. Refined cells share the cost of the parent, coarsened cells sum up the cost
+//of their children
+template <int dim>
+unsigned int ellipticBVP<dim>::cellWeight(const triangulationCellIterator& cell, const cellStatus status){
+  double cost=0.0;
+  if (status==parallel::distributed::Triangulation<dim>::CELL_COARSEN){
+    for (unsigned int child=0; child<cell->n_children(); child++) cost+=cellCost[cell->child(child)->user_index()];
+  }
+  else if (status==parallel::distributed::Triangulation<dim>::CELL_REFINE){
+    cost=cellCost[cell->user_index()]/GeometryInfo<dim>::max_children_per_cell;
+  }
+  else{
+    cost=cellCost[cell->user_index()];
+  }
+  return (unsigned int) (1000.0*cost/meanCellCost+0.5);
+}
+
+//attach the history of a cell (CELL_PERSIST and CELL_REFINE: the active cell, CELL_COARSEN:
+//the parent of the active cells to be coarsened)
+template <int dim>
+void ellipticBVP<dim>::packTransferData(const triangulationCellIterator& cell, const cellStatus status, void* data){
+  double* values=static_cast<double*>(data);
+  const unsigned int cellSize=cellHistoryDataSize(), quadPointSize=historyDataSize();
+  const unsigned int num_quad_points=childQuadPoint.size();
+  if (status==parallel::distributed::Triangulation<dim>::CELL_COARSEN){
+    //cell values are not transferred, the quadrature points of the parent from its children
+    std::fill(values, values+cellSize, 0.0);
+    for (unsigned int q=0; q<num_quad_points; q++){
+      const unsigned int childID=cell->child(childQuadPoint[q].first)->user_index();
+      packHistoryData(childID, childQuadPoint[q].second, values+cellSize+q*quadPointSize);
+    }
+  }
+  else{
+    const unsigned int cellID=cell->user_index();
+    packCellHistoryData(cellID, values);
+    for (unsigned int q=0; q<num_quad_points; q++){
+      packHistoryData(cellID, q, values+cellSize+q*quadPointSize);
+    }
+  }
+}
+
+//read the history of a cell (CELL_PERSIST and CELL_COARSEN: the active cell, CELL_REFINE:
+//the parent of the new active cells)
+template <int dim>
+void ellipticBVP<dim>::unpackTransferData(const triangulationCellIterator& cell, const cellStatus status, const void* data){
+  const double* values=static_cast<const double*>(data);
+  const unsigned int cellSize=cellHistoryDataSize(), quadPointSize=historyDataSize();
+  const unsigned int num_quad_points=childQuadPoint.size();
+  if (status==parallel::distributed::Triangulation<dim>::CELL_REFINE){
+    //the quadrature points of the children from the parent, the cell values keep their initial values
+    for (unsigned int child=0; child<cell->n_children(); child++){
+      if (!cell->child(child)->is_locally_owned()) continue;
+      const unsigned int childID=cell->child(child)->user_index();
+      for (unsigned int q=0; q<num_quad_points; q++){
+	unpackHistoryData(childID, q, values+cellSize+parentQuadPoint[child][q]*quadPointSize);
+      }
+    }
+  }
+  else{
+    const unsigned int cellID=cell->user_index();
+    if (status==parallel::distributed::Triangulation<dim>::CELL_PERSIST) unpackCellHistoryData(cellID, values);
+    for (unsigned int q=0; q<num_quad_points; q++){
+      unpackHistoryData(cellID, q, values+cellSize+q*quadPointSize);
+    }
+  }
+}
+
+//history moved with the cells. Overloaded by the material models. The
+//default methods handle the history of user models (quadHistory)
+template <int dim>
+unsigned int ellipticBVP<dim>::historyDataSize(){
+#ifdef enableUserModel
+  return quadHistory.size(2);
+#else
+  return 0;
+#endif
+}
+
+template <int dim>
+void ellipticBVP<dim>::packHistoryData(const unsigned int cellID, const unsigned int q, double* data){
+#ifdef enableUserModel
+  for (unsigned int k=0; k<quadHistory.size(2); k++) data[k]=quadHistory[cellID][q][k];
+#endif
+}
+
+template <int dim>
+void ellipticBVP<dim>::unpackHistoryData(const unsigned int cellID, const unsigned int q, const double* data){
+#ifdef enableUserModel
+  for (unsigned int k=0; k<quadHistory.size(2); k++) quadHistory[cellID][q][k]=data[k];
+#endif
+}
+
+template <int dim>
+unsigned int ellipticBVP<dim>::cellHistoryDataSize(){
+  return 0;
+}
+
+template <int dim>
+void ellipticBVP<dim>::packCellHistoryData(const unsigned int cellID, double* data){
+  //default method does nothing
+}
+
+template <int dim>
+void ellipticBVP<dim>::unpackCellHistoryData(const unsigned int cellID, const double* data){
+  //default method does nothing
+}
+
+template <int dim>
+void ellipticBVP<dim>::reinitHistoryData(const unsigned int numLocalCells){
+#ifdef enableUserModel
+  quadHistory.reinit(TableIndices<3> (numLocalCells, quadHistory.size(1), quadHistory.size(2)));
+#endif
+}
+
+template <int dim>
+void ellipticBVP<dim>::updateAfterMeshChange(){
+  //default method does nothing
+}
+
+//refinement and coarsening flags set after an increment, executed by updateMesh. Overloaded by
+//the derived classes (adaptive refinement). The default method flags no cells
+template <int dim>
+bool ellipticBVP<dim>::markCellsForRefinement(){
+  return false;
+}
+
+#endif
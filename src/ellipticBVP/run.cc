@@ -7,6 +7,34 @@
 
 template <int dim>
 void ellipticBVP<dim>::run(){
+  //thread pool for multithreaded assembly (MPI_InitFinalize in main limits
+  //each MPI process to a single thread by default)
+#ifdef enableMultithreadedAssembly
+  if (enableMultithreadedAssembly){
+    if (multithreadedAssemblySupported){
+#ifdef numAssemblyThreads
+      MultithreadInfo::set_thread_limit(numAssemblyThreads);
+#else
+      MultithreadInfo::set_thread_limit(numbers::invalid_unsigned_int);
+#endif
+      pcout << "multithreaded assembly with " << MultithreadInfo::n_threads() << " threads per MPI process\n";
+    }
+    else{
+      pcout << "multithreaded assembly not supported by this material model, using serial assembly\n";
+    }
+  }
+#endif
+
+  //matrix-free tangent, if supported by the material model (see matrixFreeTangent.cc)
+  if (matrixFreeTangent && !matrixFreeTangentSupported){
+    pcout << "matrix-free tangent not supported by this material model, assembling the jacobian\n";
+    matrixFreeTangent=false;
+  }
+  if (matrixFreeTangent && (linearPreconditioner!="jacobi") && (linearPreconditioner!="chebyshev")){
+    pcout << "\nError: preconditionerType " << linearPreconditioner << " needs the assembled jacobian. Use \"jacobi\" or \"chebyshev\" with the matrix-free tangent.\n\n";
+    exit (-1);
+  }
+
   //initialization
   computing_timer.enter_section("mesh and initialization");
   //read mesh;
@@ -18,9 +46,24 @@ void ellipticBVP<dim>::run(){
 #ifdef enableUserModel
   initQuadHistory();
 #endif
+  //restart from the last checkpoint, if requested
+#ifdef restartFromCheckpoint
+  if (restartFromCheckpoint) readCheckpoint();
+#endif
 
   computing_timer.exit_section("mesh and initialization");
 
+  //compare the assembly scatter types, if requested
+#ifndef enableUserModel
+#ifdef benchmarkAssemblyScatter
+  if (benchmarkAssemblyScatter){
+    computing_timer.enter_section("assembly benchmark");
+    benchmarkAssembly();
+    computing_timer.exit_section("assembly benchmark");
+  }
+#endif
+#endif
+
   //solve();
   solve();
 }
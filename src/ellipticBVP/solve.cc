@@ -11,7 +11,6 @@ void ellipticBVP<dim>::solve(){
   pcout << "begin solve...\n\n";
 
   //load increments
-  unsigned int successiveIncs=0;
 #ifdef enableAdaptiveTimeStepping
 #if enableAdaptiveTimeStepping==true
   for (;totalLoadFactor<totalNumIncrements;){
@@ -80,6 +79,35 @@ void ellipticBVP<dim>::solve(){
 #endif
       }
       computing_timer.exit_section("postprocess");
+
+      //write a checkpoint every checkpointInterval increments
+#ifdef checkpointInterval
+#if checkpointInterval>0
+      if ((currentIncrement+1)%checkpointInterval==0){
+	computing_timer.enter_section("checkpoint");
+	writeCheckpoint();
+	computing_timer.exit_section("checkpoint");
+      }
+#endif
+#endif
+
+      //refinement and coarsening of the mesh, if requested by the derived class
+      if (Utilities::MPI::max((unsigned int) markCellsForRefinement(), mpi_communicator)>0){
+	computing_timer.enter_section("mesh refinement");
+	updateMesh();
+	computing_timer.exit_section("mesh refinement");
+      }
+
+      //repartition the mesh by the measured constitutive cost every loadBalanceInterval increments
+#ifdef loadBalanceInterval
+#if loadBalanceInterval>0
+      if ((currentIncrement+1)%loadBalanceInterval==0){
+	computing_timer.enter_section("load balancing");
+	balanceLoad();
+	computing_timer.exit_section("load balancing");
+      }
+#endif
+#endif
     }
     else{
       successiveIncs=0;
@@ -92,6 +120,14 @@ void ellipticBVP<dim>::solve(){
   pcout << buffer;
 #endif
 #endif  
+
+  //linear solver iterations. The number and wall time of the linear solves and of the
+  //preconditioner setups are listed in the timer summary ("linear solve" and
+  //"preconditioner setup"), which has no column for the iterations
+  char statistics[200];
+  sprintf(statistics, "\ntotal linear iterations: %u (%.1f per linear solve)\n",
+	  numLinearIterations, numLinearIterations/std::max(1.0, (double) numLinearSolves));
+  pcout << statistics;
 }
 
 #endif
@@ -9,17 +9,32 @@
 template <int dim>
 void ellipticBVP<dim>::solveLinearSystem(ConstraintMatrix& constraintmatrix, matrixType& A, vectorType& b, vectorType& x, vectorType& xGhosts, vectorType& dxGhosts){ 
   vectorType completely_distributed_solutionInc (locally_owned_dofs, mpi_communicator);
+  //initial guess of the first nonlinear iteration: displacement increment of the
+  //previous increment, scaled by the ratio of the load factors
+#ifdef warmStartLinearSolver
+  if (warmStartLinearSolver && (currentIteration==0) && (previousIncrementLoadFactor>0.0)){
+    completely_distributed_solutionInc=previousIncrementSolution;
+    completely_distributed_solutionInc*=loadFactorSetByModel/previousIncrementLoadFactor;
+  }
+#endif
 #ifdef linearSolverType
-  SolverControl solver_control(maxLinearSolverIterations, relLinearSolverTolerance*b.l2_norm());
+  SolverControl solver_control(maxLinearSolverIterations, linearSolverRelTolerance*b.l2_norm());
   linearSolverType solver(solver_control, mpi_communicator);
-  PETScWrappers::PreconditionJacobi preconditioner(A);
+  if (!matrixFreeTangent) buildPreconditioner(A);
 #else
   pcout << "\nError: solverType not defined. This is required for ELLIPTIC BVP.\n\n";
   exit (-1);
 #endif
-  //solve Ax=b
+  //solve Ax=b (the "linear solve" timer section counts the solves)
+  computing_timer.enter_section("linear solve");
   try{
-    solver.solve (A, completely_distributed_solutionInc, b, preconditioner);
+    if (matrixFreeTangent){
+      //tangent applied cell by cell, Jacobi or Chebyshev preconditioner (see matrixFreeTangent.cc)
+      solveMatrixFree(completely_distributed_solutionInc, b, solver_control);
+    }
+    else{
+      solver.solve (A, completely_distributed_solutionInc, b, *jacobianPreconditioner);
+    }
     char buffer[200];
     sprintf(buffer, 
 	    "linear system solved in %3u iterations\n",
@@ -30,7 +45,15 @@ void ellipticBVP<dim>::solveLinearSystem(ConstraintMatrix& constraintmatrix, mat
     pcout << "\nWarning: solver did not converge in "
 	  << solver_control.last_step()
 	  << " iterations as per set tolerances. consider increasing maxSolverIterations or decreasing relSolverTolerance.\n";     
+    //do not reuse a (possibly outdated) preconditioner after a failed solve
+    jacobianPreconditioner.reset();
   }
+  computing_timer.exit_section("linear solve");
+  numLinearSolves++;
+  numLinearIterations+=solver_control.last_step();
+#ifdef preconditionerRebuildIterations
+  if (solver_control.last_step()>preconditionerRebuildIterations) rebuildPreconditioner=true;
+#endif
   constraintmatrix.distribute (completely_distributed_solutionInc);
   dxGhosts=completely_distributed_solutionInc;
   x+=completely_distributed_solutionInc; 
@@ -46,14 +69,15 @@ void ellipticBVP<dim>::solveLinearSystem2(ConstraintMatrix& constraintmatrix, ma
 #ifdef linearSolverType
   SolverControl solver_control(maxLinearSolverIterations, relLinearSolverTolerance*b.l2_norm());
   linearSolverType solver(solver_control, mpi_communicator);
-  PETScWrappers::PreconditionJacobi preconditioner(A);
+  //preconditioner of the mass matrix, set up in initProject
+  if (!massMatrixPreconditioner) massMatrixPreconditioner.reset(new PETScWrappers::PreconditionJacobi(A));
 #else
   pcout << "\nError: solverType not defined. This is required for ELLIPTIC BVP.\n\n";
   exit (-1);
 #endif
   //solve Ax=b
   try{
-    solver.solve (A, completely_distributed_solutionInc, b, preconditioner);
+    solver.solve (A, completely_distributed_solutionInc, b, *massMatrixPreconditioner);
     char buffer[200];
     sprintf(buffer, 
 	    "linear system solved in %3u iterations\n",
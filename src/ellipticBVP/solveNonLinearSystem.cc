@@ -9,7 +9,20 @@
 template <int dim>
 bool ellipticBVP<dim>::solveNonLinearSystem(){
   //residuals
-  double relNorm=1.0, initialNorm=1.0e-16, currentNorm=0.0;
+  double relNorm=1.0, initialNorm=1.0e-16, currentNorm=0.0, previousNorm=0.0;
+  //relative tolerance of the linear solves. With inexact Newton it is given by the
+  //Eisenstat-Walker forcing terms (choice 2, gamma=0.9, alpha=2), bounded above by
+  //maxForcingTerm and below by relLinearSolverTolerance
+  linearSolverRelTolerance=relLinearSolverTolerance;
+  bool inexactNewton=false;
+#ifdef enableInexactNewton
+  inexactNewton=enableInexactNewton;
+#endif
+#ifdef maxForcingTerm
+  const double etaMax=maxForcingTerm;
+#else
+  const double etaMax=0.1;
+#endif
 
   //non linear iterations
   char buffer[200];
@@ -22,6 +35,8 @@ bool ellipticBVP<dim>::solveNonLinearSystem(){
     computing_timer.enter_section("assembly");
     assemble();
     computing_timer.exit_section("assembly");
+    //call updateAfterAssembly, if any
+    updateAfterAssembly();
 
     if (!resetIncrement){
       //Calculate residual norms and check for convergence
@@ -48,6 +63,25 @@ bool ellipticBVP<dim>::solveNonLinearSystem(){
 	break; 
       }
       
+      //forcing term of this iteration
+      if (inexactNewton){
+	const double gamma=0.9;
+	double eta=etaMax;
+	if (currentIteration>0){
+	  const double etaPrevious=linearSolverRelTolerance;
+	  eta=gamma*std::pow(currentNorm/previousNorm, 2.0);
+	  //safeguard against a too fast decrease of the forcing terms
+	  if (gamma*etaPrevious*etaPrevious>0.1) eta=std::max(eta, gamma*etaPrevious*etaPrevious);
+	  eta=std::min(eta, etaMax);
+	  //no need to solve beyond the nonlinear tolerance
+	  eta=std::max(eta, 0.5*relNonLinearTolerance*initialNorm/currentNorm);
+	}
+	linearSolverRelTolerance=std::max(eta, (double) relLinearSolverTolerance);
+	sprintf(buffer, "inexact Newton forcing term: %8.2e\n", linearSolverRelTolerance);
+	pcout << buffer;
+      }
+      previousNorm=currentNorm;
+
       //if not converged, solveLinearSystem Ax=b
       computing_timer.enter_section("solve");
       solveLinearSystem(constraints, jacobian, residual, solution, solutionWithGhosts, solutionIncWithGhosts);
@@ -70,6 +104,15 @@ bool ellipticBVP<dim>::solveNonLinearSystem(){
     else {pcout << "stopOnConvergenceFailure==false, so marching ahead\n";}
   }
 
+  //displacement increment of this increment, used as initial guess of the next one
+#ifdef warmStartLinearSolver
+  if (warmStartLinearSolver){
+    previousIncrementSolution=solution;
+    previousIncrementSolution-=oldSolution;
+    previousIncrementLoadFactor=loadFactorSetByModel;
+  }
+#endif
+
   //update old solution to new converged solution
   oldSolution=solution;
   return true;
@@ -52,6 +52,23 @@ class continuumPlasticity : public ellipticBVP<dim>
 			  Vector<double>&     elementalResidual);
   void updateAfterIteration();
   void updateAfterIncrement();
+  /**
+   *Write/read the onset of plasticity marker to/from a checkpoint (the history is stored with the mesh).
+   */
+  void writeCheckpointData(std::ostream& out);
+  void readCheckpointData(std::istream& in);
+  /**
+   *Transfer the converged history variables (per quadrature point) and the enhanced
+   *dofs (per element) to the elements of a new mesh (see ellipticBVP<dim>::updateMesh).
+   */
+  unsigned int historyDataSize();
+  void packHistoryData(const unsigned int cellID, const unsigned int q, double* data);
+  void unpackHistoryData(const unsigned int cellID, const unsigned int q, const double* data);
+  unsigned int cellHistoryDataSize();
+  void packCellHistoryData(const unsigned int cellID, double* data);
+  void unpackCellHistoryData(const unsigned int cellID, const double* data);
+  void reinitHistoryData(const unsigned int numLocalCells);
+  void updateAfterMeshChange();
 
   /**
    *Deformation gradient tensor
@@ -155,6 +172,8 @@ ellipticBVP<dim>(),
 {
   //initialize "initCalled"
   initCalled = false;
+  //the history variables are transferred to the new mesh on refinement and repartitioning
+  ellipticBVP<dim>::repartitionSupported=true;
 
   //post processing (set up projection of von Mises stress and equivalent plastic strain
   ellipticBVP<dim>::numPostProcessedFields=2;
@@ -742,4 +761,90 @@ void continuumPlasticity<dim>::updateAfterIncrement()
   ellipticBVP<dim>::project();
 }
 
+//implementation of the writeCheckpointData method: the onset of plasticity marker (the
+//history variables and enhanced dofs are stored with the mesh, see historyDataSize)
+template <int dim>
+void continuumPlasticity<dim>::writeCheckpointData(std::ostream& out)
+{
+  checkpointWrite(out, plasticOnset);
+}
+
+//implementation of the readCheckpointData method
+template <int dim>
+void continuumPlasticity<dim>::readCheckpointData(std::istream& in)
+{
+  checkpointRead(in, plasticOnset);
+}
+
+//implementation of the historyDataSize method: invCP, xi and alpha of a quadrature point
+template <int dim>
+unsigned int continuumPlasticity<dim>::historyDataSize()
+{
+  //the layout of the history variables is set on the first assembly
+  if(initCalled == false){
+    QGauss<dim>  quadrature(quadOrder);
+    init(quadrature.size());
+  }
+  return dim*dim+dim+1;
+}
+
+template <int dim>
+void continuumPlasticity<dim>::packHistoryData(const unsigned int cellID, const unsigned int q, double* data)
+{
+  data=packCellData(histInvCP_conv[cellID][q], data);
+  data=packCellData(histXi_conv[cellID][q], data);
+  packCellData(histAlpha_conv[cellID][q], data);
+}
+
+template <int dim>
+void continuumPlasticity<dim>::unpackHistoryData(const unsigned int cellID, const unsigned int q, const double* data)
+{
+  data=unpackCellData(histInvCP_conv[cellID][q], data);
+  data=unpackCellData(histXi_conv[cellID][q], data);
+  unpackCellData(histAlpha_conv[cellID][q], data);
+}
+
+//implementation of the cellHistoryDataSize method: the enhanced dofs of an element
+template <int dim>
+unsigned int continuumPlasticity<dim>::cellHistoryDataSize()
+{
+  return 4*dim;
+}
+
+template <int dim>
+void continuumPlasticity<dim>::packCellHistoryData(const unsigned int cellID, double* data)
+{
+  for (unsigned int i=0; i<4*dim; i++) data[i]=enhStrain.Alpha(4*dim*cellID+i);
+}
+
+template <int dim>
+void continuumPlasticity<dim>::unpackCellHistoryData(const unsigned int cellID, const double* data)
+{
+  for (unsigned int i=0; i<4*dim; i++) enhStrain.Alpha(4*dim*cellID+i)=data[i];
+}
+
+//implementation of the reinitHistoryData method. Refined and coarsened elements keep
+//the initial (zero) enhanced dofs
+template <int dim>
+void continuumPlasticity<dim>::reinitHistoryData(const unsigned int numLocalCells)
+{
+  const unsigned int num_quad_points=QGauss<dim>(quadOrder).size();
+  Vector<double> zero_vec(dim); zero_vec = 0.;
+  histInvCP_conv.assign(numLocalCells,std::vector<FullMatrix<double> >(num_quad_points,IdentityMatrix(dim)));
+  histAlpha_conv.assign(numLocalCells,std::vector<double>(num_quad_points,0));
+  histXi_conv.assign(numLocalCells,std::vector<Vector<double> >(num_quad_points,zero_vec));
+  enhStrain.init_enh_dofs(numLocalCells);
+  projectVonMisesStress.assign(numLocalCells,std::vector<double>(num_quad_points,0));
+}
+
+//implementation of the updateAfterMeshChange method
+template <int dim>
+void continuumPlasticity<dim>::updateAfterMeshChange()
+{
+  //iteration values start from the converged ones, as after an increment
+  histInvCP_iter = histInvCP_conv;
+  histAlpha_iter = histAlpha_conv;
+  histXi_iter = histXi_conv;
+}
+
 #endif
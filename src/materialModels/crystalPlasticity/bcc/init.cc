@@ -14,7 +14,6 @@ void crystalPlasticity<dim>::init(unsigned int num_quad_points)
     global_stress=0.0;
     
     unsigned int num_local_cells = this->triangulation.n_locally_owned_active_cells();
-    F.reinit(dim, dim);
     
     // Read in the slip systems
     n_slip_systems=numSlipSystems;
@@ -111,25 +110,56 @@ void crystalPlasticity<dim>::init(unsigned int num_quad_points)
     }
     
     //Resize the vectors of history variables
-    Fp_conv.resize(num_local_cells,std::vector<FullMatrix<double> >(num_quad_points,IdentityMatrix(dim)));
-    Fe_conv.resize(num_local_cells,std::vector<FullMatrix<double> >(num_quad_points,IdentityMatrix(dim)));
-    s_alpha_conv.resize(num_local_cells,std::vector<Vector<double> >(num_quad_points,s0_init));
-    Fp_iter.resize(num_local_cells,std::vector<FullMatrix<double> >(num_quad_points,IdentityMatrix(dim)));
-    Fe_iter.resize(num_local_cells,std::vector<FullMatrix<double> >(num_quad_points,IdentityMatrix(dim)));
-    s_alpha_iter.resize(num_local_cells,std::vector<Vector<double> >(num_quad_points,s0_init));
-    rot.resize(num_local_cells,std::vector<Vector<double> >(num_quad_points,rot_init));
-    rotnew.resize(num_local_cells,std::vector<Vector<double> >(num_quad_points,rotnew_init));
+    Fp_conv.reinit(num_local_cells,num_quad_points,IdentityMatrix(dim));
+    Fe_conv.reinit(num_local_cells,num_quad_points,IdentityMatrix(dim));
+    s_alpha_conv.reinit(num_local_cells,num_quad_points,s0_init);
+    Fp_iter.reinit(num_local_cells,num_quad_points,IdentityMatrix(dim));
+    Fe_iter.reinit(num_local_cells,num_quad_points,IdentityMatrix(dim));
+    s_alpha_iter.reinit(num_local_cells,num_quad_points,s0_init);
+    rot.reinit(num_local_cells,num_quad_points,rot_init);
+    rotnew.reinit(num_local_cells,num_quad_points,rotnew_init);
+    rotationMatrix.reinit(num_local_cells,num_quad_points,IdentityMatrix(dim));
+    //stored constitutive updates of the selective re-evaluation
+    if (reevaluationTolerance>=0.0){
+        lastUpdate.reinit(num_local_cells,num_quad_points);
+        const double memory=Utilities::MPI::sum((double) lastUpdate.memory_consumption(), this->mpi_communicator);
+        char buffer[200];
+        sprintf(buffer, "selective re-evaluation: tolerance %8.2e on the entries of F, %8.2f MB of stored constitutive updates\n", reevaluationTolerance, memory/(1024.0*1024.0));
+        this->pcout << buffer;
+    }
     
     //load rot and rotnew
     for (unsigned int cell=0; cell<num_local_cells; cell++){
         for (unsigned int q=0; q<num_quad_points; q++){
             unsigned int materialID=quadratureOrientationsMap[cell][q];
             for (unsigned int i=0; i<dim; i++){
-                rot[cell][q][i]=orientations.eulerAngles[materialID][i];
-                rotnew[cell][q][i]=orientations.eulerAngles[materialID][i];
+                rot(cell,q)[i]=orientations.eulerAngles[materialID][i];
+                rotnew(cell,q)[i]=orientations.eulerAngles[materialID][i];
+            }
+            updateRotationMatrix(cell,q);
+        }
+    }
+    //Schmid tensors S_alpha=m_alpha*n_alpha' of the slip systems (stacked row-wise) and elastic
+    //stiffness acting on the row-wise components of a second order tensor. Both only depend on
+    //the slip system files and the elastic constants, so they are computed once here instead
+    //of at every call of calculatePlasticity
+    SCHMID_TENSOR1.reinit(n_slip_systems*dim,dim);
+    for(unsigned int i=0;i<n_slip_systems;i++){
+        for (unsigned int j=0;j<dim;j++){
+            for (unsigned int k=0;k<dim;k++){
+                SCHMID_TENSOR1[dim*i+j][k]=m_alpha[i][j]*n_alpha[i][k];
             }
         }
     }
+    
+    unsigned int voigtIndex[9]={0,5,4,5,1,3,4,3,2};
+    TM.reinit(dim*dim,dim*dim);
+    for(unsigned int i=0;i<9;i++){
+        for(unsigned int j=0;j<9;j++){
+            TM[i][j]=elasticStiffness[voigtIndex[i]][voigtIndex[j]];
+        }
+    }
+    
     N_qpts=num_quad_points;
     initCalled=true;
 }
@@ -9,7 +9,7 @@ void crystalPlasticity<dim>::reorient() {
     FullMatrix<double> C_old_temp(dim,dim),C_new_temp(dim,dim),Fe_old(dim,dim), Fe_new(dim,dim), eigenvectors(dim,dim),Lambda(dim,dim),U_old(dim,dim),U_new(dim,dim),R_old(dim,dim),R_new(dim,dim),Omega(dim,dim),temp(dim,dim);
     Lambda=IdentityMatrix(dim);
     Omega=0.0;
-    Vector<double> rot1(dim),Omega_vec(dim),rold(dim),dr(dim),rnew(dim);
+    Vector<double> Omega_vec(dim),rold(dim),dr(dim),rnew(dim);
     FullMatrix<double> rotmat(dim,dim);
     //int itgno;
     unsigned int num_local_cells = this->triangulation.n_locally_owned_active_cells();
@@ -20,8 +20,8 @@ void crystalPlasticity<dim>::reorient() {
             C_old_temp=0.0;
             C_old=0.0;
             
-            Fe_old=Fe_conv[i][j];
-            Fe_new=Fe_iter[i][j];
+            Fe_conv.get(i,j,Fe_old);
+            Fe_iter.get(i,j,Fe_new);
             Fe_old.Tmmult(C_old_temp,Fe_old);
             C_old=C_old_temp;
             C_old.compute_eigenvalues_symmetric(0.0,200000.0,1e-15,eigenvalues, eigenvectors);
@@ -52,10 +52,8 @@ void crystalPlasticity<dim>::reorient() {
             temp=Omega; temp.mTmult(Omega,R_new);
             
             
-            rot1=rot[i][j];
-            rold=rotnew[i][j];
-            rotmat=0.0;
-            odfpoint(rotmat,rot1);
+            rotnew.get(i,j,rold);
+            rotationMatrix.get(i,j,rotmat);
             
             temp=Omega;
             temp.mTmult(Omega,rotmat);
@@ -80,7 +78,7 @@ void crystalPlasticity<dim>::reorient() {
             rnew=0.0; rnew.add(1.0,rold); rnew.add(1.0,dr);
             
             
-            rotnew[i][j]=rnew;
+            rotnew.set(i,j,rnew);
             
             
         }
@@ -1,13 +1,21 @@
 
 template <int dim>
-void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
-                                                 unsigned int quadPtID)
+void crystalPlasticity<dim>::calculatePlasticity2(constitutiveBatch<dim> &batch,
+                                                 unsigned int p,
+                                                 quadPointData &qpData)
 {
+    //cell and quadrature point of the twin and slip volume fractions
+    const unsigned int cellID=batch.cellID(p), quadPtID=batch.quadPt(p);
+    plasticityWorkspace &work=qpData.work;
+    FullMatrix<double> &F=qpData.F, &F_tau=qpData.F_tau, &FP_tau=qpData.FP_tau, &FE_tau=qpData.FE_tau, &T=qpData.T, &P=qpData.P;
+    FullMatrix<double> &dP_dF=qpData.dP_dF;
+    Vector<double> &sres_tau2=qpData.sres_tau2;
     
     F_tau=F; // Deformation Gradient
-    FullMatrix<double> FE_t(dim,dim),FP_t(dim,dim);  //Elastic and Plastic deformation gradient
-    Vector<double> s_alpha_t2(n_slip_systems2); // Slip resistance
-    Vector<double> rot1(dim);// Crystal orientation (Rodrigues representation)
+    FullMatrix<double> &FE_t=work.FE_t, &FP_t=work.FP_t;  //Elastic and Plastic deformation gradient
+    FE_t.reinit(dim,dim); FP_t.reinit(dim,dim);
+    Vector<double> &s_alpha_t2=work.s_alpha_t2; // Slip resistance
+    s_alpha_t2.reinit(n_slip_systems2);
     
     int old_precision = std::cout.precision();
     
@@ -19,22 +27,27 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
     
     std::cout.precision(16);
     
-    FE_t=Fe_conv[cellID][quadPtID];
-    FP_t=Fp_conv[cellID][quadPtID];
-    s_alpha_t2=s_alpha_conv2[cellID][quadPtID];
-    rot1=rot[cellID][quadPtID];
+    //converged history of the point (FE_t, FP_t, rotation matrix, slip resistances),
+    //gathered by calculatePlasticityBatch
+    const double* history=batch.historyIn_ptr(p);
+    history=unpackCellData(FE_t,history);
+    history=unpackCellData(FP_t,history);
     
     
     
-    // Rotation matrix of the crystal orientation
-    FullMatrix<double> rotmat(dim,dim);
-    rotmat=0.0;
-    odfpoint(rotmat,rot1);
+    // Rotation matrix of the crystal orientation (cached, see updateRotationMatrix)
+    FullMatrix<double> &rotmat=work.rotmat;
+    rotmat.reinit(dim,dim);
+    history=unpackCellData(rotmat,history);
+    unpackCellData(s_alpha_t2,history);
     
     
-    FullMatrix<double> temp(dim,dim),temp1(dim,dim),temp2(dim,dim),temp3(dim,dim),temp4(dim,dim),temp5(dim,dim),temp6(dim,dim); // Temporary matrices
-    FullMatrix<double> T_tau(dim,dim),P_tau(dim,dim);
-    FullMatrix<double> Fpn_inv(dim,dim),FE_tau_trial(dim,dim),F_trial(dim,dim),CE_tau_trial(dim,dim),FP_t2(dim,dim),Ee_tau_trial(dim,dim);
+    FullMatrix<double> &temp=work.temp, &temp1=work.temp1, &temp2=work.temp2, &temp3=work.temp3, &temp4=work.temp4, &temp5=work.temp5, &temp6=work.temp6, &CE_exp_FP=work.CE_exp_FP; // Temporary matrices
+    temp.reinit(dim,dim); temp1.reinit(dim,dim); temp2.reinit(dim,dim); temp3.reinit(dim,dim); temp4.reinit(dim,dim); temp5.reinit(dim,dim); temp6.reinit(dim,dim);
+    FullMatrix<double> &T_tau=work.T_tau, &P_tau=work.P_tau;
+    T_tau.reinit(dim,dim); P_tau.reinit(dim,dim);
+    FullMatrix<double> &Fpn_inv=work.Fpn_inv, &FE_tau_trial=work.FE_tau_trial, &F_trial=work.F_trial, &CE_tau_trial=work.CE_tau_trial, &FP_t2=work.FP_t2, &Ee_tau_trial=work.Ee_tau_trial;
+    Fpn_inv.reinit(dim,dim); FE_tau_trial.reinit(dim,dim); F_trial.reinit(dim,dim); CE_tau_trial.reinit(dim,dim); FP_t2.reinit(dim,dim); Ee_tau_trial.reinit(dim,dim);
     
     
     
@@ -44,80 +57,45 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
     temp.mmult(F_tau,rotmat);
     
     
-    // Calculation of Schmid Tensors  and B= symm(FE_tau_trial'*FE_tau_trial*S_alpha)
-    FullMatrix<double> SCHMID_TENSOR1(n_slip_systems2*dim,dim),B(n_slip_systems2*dim,dim);
-    Vector<double> m1(dim),n1(dim);
+    // Schmid tensors and elastic stiffness of this phase, precomputed in init()
+    const FullMatrix<double> &SCHMID_TENSOR1=SCHMID_TENSOR12, &TM=TM12;
     
-    for(unsigned int i=0;i<n_slip_systems2;i++){
-        for (unsigned int j=0;j<dim;j++){
-            m1(j)=m_alpha2[i][j];
-            n1(j)=n_alpha2[i][j];
-        }
-        
-        for (unsigned int j=0;j<dim;j++){
-            for (unsigned int k=0;k<dim;k++){
-                temp[j][k]=m1(j)*n1(k);
-                SCHMID_TENSOR1[dim*i+j][k]=m1(j)*n1(k);
-            }
-        }
-        
-        CE_tau_trial.mmult(temp2,temp);
-        temp2.symmetrize();
-        for (unsigned int j=0;j<dim;j++){
-            for (unsigned int k=0;k<dim;k++){
-                B[dim*i+j][k]=2*temp2[j][k];
-            }
-        }
-    }
-    
-    // Elastic Modulus
-    
-    FullMatrix<double> Dmat2(2*dim,2*dim),TM(dim*dim,dim*dim);
-    Vector<double> vec1(2*dim),vec2(dim*dim);
-
-    
-    for(unsigned int i=0;i<6;i++){
-        for(unsigned int j=0;j<6;j++){
-            Dmat2[i][j] = elasticStiffness2[i][j];
-        }
-    }
-
-    
-    vec1(0)=0;vec1(1)=5;vec1(2)=4;vec1(3)=1;vec1(4)=3;vec1(5)=2;
-    vec2(0)=0;vec2(1)=5;vec2(2)=4;vec2(3)=5;vec2(4)=1;vec2(5)=3;vec2(6)=4;vec2(7)=3;vec2(8)=2;
-    
-    
-    
-    for(unsigned int i=0;i<9;i++){
-        for(unsigned int j=0;j<9;j++){
-            TM[i][j]=Dmat2(vec2(i),vec2(j));
-        }
-    }
-    
-    Vector<double> s_alpha_tau;
+    Vector<double> &s_alpha_tau=work.s_alpha_tau;
     FP_tau=FP_t;
     FE_tau.reinit(dim,dim);
     Fpn_inv=0.0; Fpn_inv.invert(FP_t);
     F_tau.mmult(FE_tau,Fpn_inv);
     s_alpha_tau=s_alpha_t2;
     
-    Vector<double> s_beta(n_slip_systems2),h_beta(n_slip_systems2),delh_beta_dels(n_slip_systems2),h0(n_slip_systems2),a_pow(n_slip_systems2),s_s(n_slip_systems2);
-    FullMatrix<double> h_alpha_beta_t(n_slip_systems2,n_slip_systems2),A(n_slip_systems2,n_slip_systems2);
-    FullMatrix<double> del_FP(dim,dim);
-    FullMatrix<double> A_PA;
-    Vector<double> active;
-    Vector<double> PA, PA_temp(1);
-    Vector<double> resolved_shear_tau_trial(n_slip_systems2),b(n_slip_systems2),resolved_shear_tau(n_slip_systems2);
-    Vector<double> x_beta_old(n_slip_systems2);
-    
-    Vector<double> x_beta(n_slip_systems2);
-    
-    FullMatrix<double> PK1_Stiff(dim*dim,dim*dim);
-    
-    FullMatrix<double> delFp_delF(dim*dim,dim*dim),delFp_delF2(dim*dim,dim*dim),delFp_delF_prev(dim*dim,dim*dim),dels_delF(n_slip_systems2,dim*dim),dels_delF_prev(n_slip_systems2,dim*dim),A2;
-    FullMatrix<double> delFe_delF(dim*dim,dim*dim),delEtrial_delF(dim*dim,dim*dim),deltau_delF(dim*dim,dim*dim),delT_delF(dim*dim,dim*dim),delb_delF,delgamma_delF,S_PA,A_ds(n_slip_systems2,n_slip_systems2),delgamma_delF2(n_slip_systems2,dim*dim),delTstar_delF(dim*dim,dim*dim);
-    FullMatrix<double> Ce_tau(dim,dim),T_star_tau(dim,dim);
-    FullMatrix<double> T_star_tau_trial(dim,dim),diff_FP(dim,dim);
+    Vector<double> &s_beta=work.s_beta, &h_beta=work.h_beta, &delh_beta_dels=work.delh_beta_dels, &h0=work.h0, &a_pow=work.a_pow, &s_s=work.s_s;
+    s_beta.reinit(n_slip_systems2); h_beta.reinit(n_slip_systems2); delh_beta_dels.reinit(n_slip_systems2); h0.reinit(n_slip_systems2); a_pow.reinit(n_slip_systems2); s_s.reinit(n_slip_systems2);
+    FullMatrix<double> &h_alpha_beta_t=work.h_alpha_beta_t, &A=work.A;
+    h_alpha_beta_t.reinit(n_slip_systems2,n_slip_systems2); A.reinit(n_slip_systems2,n_slip_systems2);
+    FullMatrix<double> &del_FP=work.del_FP;
+    del_FP.reinit(dim,dim);
+    FullMatrix<double> &A_PA=work.A_PA;
+    Vector<double> &active=work.active;
+    Vector<double> &PA=work.PA, &PA_temp=work.PA_temp;
+    PA_temp.reinit(1);
+    Vector<double> &resolved_shear_tau_trial=work.resolved_shear_tau_trial, &b=work.b, &resolved_shear_tau=work.resolved_shear_tau;
+    resolved_shear_tau_trial.reinit(n_slip_systems2); b.reinit(n_slip_systems2); resolved_shear_tau.reinit(n_slip_systems2);
+    Vector<double> &x_beta_old=work.x_beta_old;
+    x_beta_old.reinit(n_slip_systems2);
+    
+    Vector<double> &x_beta=work.x_beta;
+    x_beta.reinit(n_slip_systems2);
+    
+    FullMatrix<double> &PK1_Stiff=work.PK1_Stiff;
+    PK1_Stiff.reinit(dim*dim,dim*dim);
+    
+    FullMatrix<double> &delFp_delF=work.delFp_delF, &delFp_delF2=work.delFp_delF2, &delFp_delF_prev=work.delFp_delF_prev, &dels_delF=work.dels_delF, &dels_delF_prev=work.dels_delF_prev, &A2=work.A2;
+    delFp_delF.reinit(dim*dim,dim*dim); delFp_delF2.reinit(dim*dim,dim*dim); delFp_delF_prev.reinit(dim*dim,dim*dim); dels_delF.reinit(n_slip_systems2,dim*dim); dels_delF_prev.reinit(n_slip_systems2,dim*dim);
+    FullMatrix<double> &delFe_delF=work.delFe_delF, &delEtrial_delF=work.delEtrial_delF, &deltau_delF=work.deltau_delF, &delT_delF=work.delT_delF, &delb_delF=work.delb_delF, &delgamma_delF=work.delgamma_delF, &S_PA=work.S_PA, &A_ds=work.A_ds, &delgamma_delF2=work.delgamma_delF2, &delTstar_delF=work.delTstar_delF;
+    delFe_delF.reinit(dim*dim,dim*dim); delEtrial_delF.reinit(dim*dim,dim*dim); deltau_delF.reinit(dim*dim,dim*dim); delT_delF.reinit(dim*dim,dim*dim); A_ds.reinit(n_slip_systems2,n_slip_systems2); delgamma_delF2.reinit(n_slip_systems2,dim*dim); delTstar_delF.reinit(dim*dim,dim*dim);
+    FullMatrix<double> &Ce_tau=work.Ce_tau, &T_star_tau=work.T_star_tau;
+    Ce_tau.reinit(dim,dim); T_star_tau.reinit(dim,dim);
+    FullMatrix<double> &T_star_tau_trial=work.T_star_tau_trial, &diff_FP=work.diff_FP;
+    T_star_tau_trial.reinit(dim,dim); diff_FP.reinit(dim,dim);
     
     
     
@@ -161,9 +139,10 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
         
         //% % % % % STEP 2 % % % % %
         // Calculate the trial stress T_star_tau_trial
-        Vector<double> tempv1(6),tempv2(6);
+        Vector<double> &tempv1=work.tempv1, &tempv2=work.tempv2, &tempv3=work.tempv3;
+        tempv1.reinit(6); tempv2.reinit(6); tempv3.reinit(6);
         tempv1=0.0;
-        Dmat12.vmult(tempv1, vecform(Ee_tau_trial));
+        vecform(Ee_tau_trial,tempv3); Dmat12.vmult(tempv1,tempv3);
         matform(T_star_tau_trial,tempv1);
         T_star_tau.equ(1.0,T_star_tau_trial);
         
@@ -263,7 +242,7 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
                 }
                 temp2.reinit(dim,dim); CE_tau_trial.mmult(temp2,temp);
                 temp2.symmetrize();
-                tempv1=0.0; Dmat12.vmult(tempv1, vecform(temp2));
+                tempv1=0.0; vecform(temp2,tempv3); Dmat12.vmult(tempv1,tempv3);
                 temp3=0.0; matform(temp3,tempv1);
                 
                 CE_tau_trial.mmult(temp1,temp3);
@@ -290,7 +269,8 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
         
         int count1=0;
         
-        Vector<double> b_PA(n_PA);
+        Vector<double> &b_PA=work.b_PA;
+        b_PA.reinit(n_PA);
         
         for(unsigned int i=0;i<n_PA;i++){
             b_PA(i)=b(PA(i));
@@ -315,7 +295,7 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
             
             //Modified slip system search for adding corrective term
             // [x_beta] = INACTIVE_SLIP_REMOVAL(A,b,PA,x_beta_old);
-            inactive_slip_removal2(active,x_beta_old,x_beta,n_PA,PA,b,A,A_PA);
+            inactive_slip_removal2(active,x_beta_old,x_beta,n_PA,PA,b,A,A_PA,work.slipSolver);
             temp.reinit(dim,dim);
             del_FP.reinit(dim,dim);
             del_FP=0.0;
@@ -338,7 +318,7 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
                 
             }
             
-            matrixExponential(del_FP).mmult(FP_tau,FP_t2);
+            matrixExponential(del_FP,temp); temp.mmult(FP_tau,FP_t2);
             
             // % % % % % STEP 8 % % % % %
             temp.invert(FP_tau);
@@ -355,7 +335,7 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
             }
             
             
-            Dmat12.vmult(tempv1, vecform(Ee_tau_trial));
+            vecform(Ee_tau_trial,tempv3); Dmat12.vmult(tempv1,tempv3);
             matform(T_star_tau,tempv1);
             
             
@@ -484,18 +464,6 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
         
         
         deltau_delF=0.0;
-        temp.reinit(dim,dim);
-        temp=0.0;
-        temp.Tadd(-1.0,del_FP);
-        temp1.reinit(dim,dim);
-        temp1=matrixExponential(temp);
-        
-        
-        temp1.reinit(dim,dim);
-        temp=0.0;
-        temp.add(-1.0,del_FP);
-        temp2.reinit(dim,dim);
-        temp2=matrixExponential(temp);
         TM.mmult(delT_delF,delEtrial_delF);
         
         for (unsigned int i=0;i<dim;i++){
@@ -529,7 +497,8 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
 
 
         
-        FullMatrix<double> term_ds(n_slip_systems2,n_slip_systems2);
+        FullMatrix<double> &term_ds=work.term_ds;
+        term_ds.reinit(n_slip_systems2,n_slip_systems2);
         term_ds=0.0;
         
         for(unsigned int k=0;k<n_slip_systems2;k++){
@@ -599,6 +568,11 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
         }
         
         
+        //CE_tau_trial*exp(-del_FP) is the same for all slip system pairs
+        temp5.reinit(dim,dim); temp5.equ(-1.0,del_FP);
+        matrixExponential(temp5,temp6);
+        CE_exp_FP.reinit(dim,dim); CE_tau_trial.mmult(CE_exp_FP,temp6);
+        
         //Calculate the Stiffness Matrix A
         for(unsigned int j=0;j<n_PA;j++){
             temp.reinit(dim,dim); temp=0.0;
@@ -647,13 +621,10 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
             
             for(unsigned int i=0;i<n_PA;i++){
                 
-                temp5=del_FP;
-                temp5.equ(-1.0,temp5);
-                temp6.reinit(dim,dim); CE_tau_trial.mmult(temp6,matrixExponential(temp5));
-                diff_FP.Tmmult(temp2,temp6);
+                diff_FP.Tmmult(temp2,CE_exp_FP);
                 temp2.symmetrize();
                 tempv1.reinit(2*dim);
-                tempv1=0.0; Dmat12.vmult(tempv1, vecform(temp2));
+                tempv1=0.0; vecform(temp2,tempv3); Dmat12.vmult(tempv1,tempv3);
                 temp3=0.0; matform(temp3,tempv1);
                 
                 Ce_tau.mmult(temp,temp3);
@@ -765,8 +736,7 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
         S_PA.mmult(delFp_delF2,delgamma_delF);
         
         delFp_delF=0.0;
-        temp1.reinit(dim,dim);
-        temp1=matrixExponential(del_FP);
+        matrixExponential(del_FP,temp1);
         
         for (unsigned int i=0;i<dim;i++){
             for (unsigned int j=0;j<dim;j++){
@@ -798,54 +768,60 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
     
     
     
-    delFe_delF=0.0;
-    temp1.reinit(dim,dim);
-    F_tau.mmult(temp1,Fpn_inv);
-    
-    for (unsigned int i=0;i<dim;i++){
-        for (unsigned int j=0;j<dim;j++){
-            for (unsigned int k=0;k<dim;k++){
-                for (unsigned int l=0;l<dim;l++){
-                    for (unsigned int a=0;a<dim;a++){
-                        for (unsigned int b=0;b<dim;b++){
-                            delFe_delF(3*i+j,3*k+l)=delFe_delF(3*i+j,3*k+l)-temp1(i,a)*delFp_delF(3*a+b,3*k+l)*Fpn_inv(b,j);
+    //elastic predictor: no slip system became active in the first slip search, so
+    //FP_tau=FP_t, T_star_tau=T_star_tau_trial and delFp_delF=0. The tangent then
+    //reduces to two 9x9 products and a few rank-one terms (elastic fast path)
+    qpData.elastic=(iter1==1) && (n_PA==0);
+    
+    if (!qpData.elastic){
+        delFe_delF=0.0;
+        temp1.reinit(dim,dim);
+        F_tau.mmult(temp1,Fpn_inv);
+    
+        for (unsigned int i=0;i<dim;i++){
+            for (unsigned int j=0;j<dim;j++){
+                for (unsigned int k=0;k<dim;k++){
+                    for (unsigned int l=0;l<dim;l++){
+                        for (unsigned int a=0;a<dim;a++){
+                            for (unsigned int b=0;b<dim;b++){
+                                delFe_delF(3*i+j,3*k+l)=delFe_delF(3*i+j,3*k+l)-temp1(i,a)*delFp_delF(3*a+b,3*k+l)*Fpn_inv(b,j);
+                            }
+                        }
+                        if(i==k){
+                            delFe_delF(3*i+j,3*k+l)=delFe_delF(3*i+j,3*k+l)+Fpn_inv(l,j);
                         }
-                    }
-                    if(i==k){
-                        delFe_delF(3*i+j,3*k+l)=delFe_delF(3*i+j,3*k+l)+Fpn_inv(l,j);
                     }
                 }
             }
         }
-    }
     
-    delTstar_delF=0.0;
+        delTstar_delF=0.0;
     
     
     
-    for (unsigned int i=0;i<dim;i++){
-        for (unsigned int j=0;j<dim;j++){
-            for (unsigned int k=0;k<dim;k++){
-                for (unsigned int l=0;l<dim;l++){
-                    for (unsigned int a=0;a<dim;a++){
-                        for (unsigned int b=0;b<dim;b++){
-                            for (unsigned int c=0;c<dim;c++){
+        for (unsigned int i=0;i<dim;i++){
+            for (unsigned int j=0;j<dim;j++){
+                for (unsigned int k=0;k<dim;k++){
+                    for (unsigned int l=0;l<dim;l++){
+                        for (unsigned int a=0;a<dim;a++){
+                            for (unsigned int b=0;b<dim;b++){
+                                for (unsigned int c=0;c<dim;c++){
                                 
                                 
-                                delTstar_delF(3*(i)+j,3*(k)+l)=delTstar_delF(3*(i)+j,3*(k)+l)+ TM(3*(i)+j,3*(a)+b)*delFe_delF(3*(c)+a,3*(k)+l)*FE_tau(c,b);
+                                    delTstar_delF(3*(i)+j,3*(k)+l)=delTstar_delF(3*(i)+j,3*(k)+l)+ TM(3*(i)+j,3*(a)+b)*delFe_delF(3*(c)+a,3*(k)+l)*FE_tau(c,b);
                                 
+                                }
                             }
                         }
-                    }
                     
+                    }
                 }
             }
         }
     }
     
-    
-    
-    FullMatrix<double> PK_Stiff5(dim*dim,dim*dim);
+    FullMatrix<double> &PK_Stiff5=work.PK_Stiff5;
+    PK_Stiff5.reinit(dim*dim,dim*dim);
     PK_Stiff5=0.0;
     temp4.reinit(dim,dim);
     temp4.invert(F_tau);
@@ -861,17 +837,51 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
     temp3.mTmult(temp5,F_tau);
     temp6=IdentityMatrix(dim);
     
-    for (unsigned int i=0;i<dim;i++){
-        for (unsigned int j=0;j<dim;j++){
-            for (unsigned int k=0;k<dim;k++){
-                for (unsigned int l=0;l<dim;l++){
-                    for (unsigned int a=0;a<dim;a++){
-                        for (unsigned int b=0;b<dim;b++){
-                            PK_Stiff5(3*(i)+j,3*(k)+l)=PK_Stiff5(3*(i)+j,3*(k)+l)+ temp6(i,a)*delFe_delF(3*(a)+b,3*(k)+l)*temp1(b,j)+FE_tau(i,a)*delTstar_delF(3*(a)+b,3*(k)+l)*temp2(j,b)-temp3(i,a)*delFe_delF(3*(a)+b,3*(k)+l)*temp4(j,b);
-                        }
-                        PK_Stiff5(3*(i)+j,3*(k)+l)=PK_Stiff5(3*(i)+j,3*(k)+l)-temp5(i,a)*temp4(j,k)*temp4(l,a);
+    if (qpData.elastic){
+        //delTstar_delF=TM*M with M(ab,kl)=Fpn_inv(l,a)*FE_tau(k,b), and
+        //PK_Stiff5=N*delTstar_delF with N(ij,ab)=FE_tau(i,a)*temp2(j,b)
+        FullMatrix<double> &elasticM=work.elasticM, &elasticN=work.elasticN, &temp7=work.temp7;
+        elasticM.reinit(dim*dim,dim*dim); elasticN.reinit(dim*dim,dim*dim); temp7.reinit(dim,dim);
+        for (unsigned int a=0;a<dim;a++){
+            for (unsigned int b=0;b<dim;b++){
+                for (unsigned int k=0;k<dim;k++){
+                    for (unsigned int l=0;l<dim;l++){
+                        elasticM(dim*a+b,dim*k+l)=Fpn_inv(l,a)*FE_tau(k,b);
+                        elasticN(dim*k+l,dim*a+b)=FE_tau(k,a)*temp2(l,b);
+                    }
+                }
+            }
+        }
+        TM.mmult(delTstar_delF,elasticM);
+        elasticN.mmult(PK_Stiff5,delTstar_delF);
+        
+        //remaining terms with delFe_delF(ab,kl)=del(a,k)*Fpn_inv(l,b)
+        Fpn_inv.mmult(temp6,temp1);
+        temp.reinit(dim,dim); temp4.mTmult(temp,Fpn_inv);
+        temp5.mTmult(temp7,temp4);
+        for (unsigned int i=0;i<dim;i++){
+            for (unsigned int j=0;j<dim;j++){
+                for (unsigned int k=0;k<dim;k++){
+                    for (unsigned int l=0;l<dim;l++){
+                        PK_Stiff5(dim*i+j,dim*k+l)+=(i==k)*temp6(l,j)-temp3(i,k)*temp(j,l)-temp7(i,l)*temp4(j,k);
                     }
+                }
+            }
+        }
+    }
+    else{
+        for (unsigned int i=0;i<dim;i++){
+            for (unsigned int j=0;j<dim;j++){
+                for (unsigned int k=0;k<dim;k++){
+                    for (unsigned int l=0;l<dim;l++){
+                        for (unsigned int a=0;a<dim;a++){
+                            for (unsigned int b=0;b<dim;b++){
+                                PK_Stiff5(3*(i)+j,3*(k)+l)=PK_Stiff5(3*(i)+j,3*(k)+l)+ temp6(i,a)*delFe_delF(3*(a)+b,3*(k)+l)*temp1(b,j)+FE_tau(i,a)*delTstar_delF(3*(a)+b,3*(k)+l)*temp2(j,b)-temp3(i,a)*delFe_delF(3*(a)+b,3*(k)+l)*temp4(j,b);
+                            }
+                            PK_Stiff5(3*(i)+j,3*(k)+l)=PK_Stiff5(3*(i)+j,3*(k)+l)-temp5(i,a)*temp4(j,k)*temp4(l,a);
+                        }
                     
+                    }
                 }
             }
         }
@@ -885,32 +895,26 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
     rotmat.mmult(P_tau,temp);
     
     
-    dP_dF=0.0;
-    FullMatrix<double> L(dim,dim),mn(dim,dim);
+    FullMatrix<double> &L=work.L, &LL=work.LL, &PK_Stiff_LL=work.PK_Stiff_LL;
+    L.reinit(dim,dim);
     L=0.0;
     temp1.reinit(dim,dim); temp1=IdentityMatrix(dim);
     rotmat.Tmmult(L,temp1);
     
-    // Transform the tangent modulus back to crystal frame
-    
-    
-    for(unsigned int m=0;m<dim;m++){
-        for(unsigned int n=0;n<dim;n++){
-            for(unsigned int o=0;o<dim;o++){
-                for(unsigned int p=0;p<dim;p++){
-                    for(unsigned int i=0;i<dim;i++){
-                        for(unsigned int j=0;j<dim;j++){
-                            for(unsigned int k=0;k<dim;k++){
-                                for(unsigned int l=0;l<dim;l++){
-                                    dP_dF[m][n][o][p]=dP_dF[m][n][o][p]+PK_Stiff5(dim*i+j,dim*k+l)*L(i,m)*L(j,n)*L(k,o)*L(l,p);
-                                }
-                            }
-                        }
-                    }
+    // Transform the tangent modulus back to crystal frame,
+    // dP_dF=LL^T*PK_Stiff5*LL with LL(dim*i+j,dim*m+n)=L(i,m)*L(j,n)
+    LL.reinit(dim*dim,dim*dim); PK_Stiff_LL.reinit(dim*dim,dim*dim);
+    for(unsigned int i=0;i<dim;i++){
+        for(unsigned int j=0;j<dim;j++){
+            for(unsigned int m=0;m<dim;m++){
+                for(unsigned int n=0;n<dim;n++){
+                    LL(dim*i+j,dim*m+n)=L(i,m)*L(j,n);
                 }
             }
         }
     }
+    PK_Stiff5.mmult(PK_Stiff_LL,LL);
+    LL.Tmmult(dP_dF,PK_Stiff_LL);
     
     P.reinit(dim,dim);
     P=P_tau;
@@ -920,10 +924,11 @@ void crystalPlasticity<dim>::calculatePlasticity2(unsigned int cellID,
     sres_tau2.reinit(n_slip_systems2);
     sres_tau2 = s_alpha_tau;
     
-    // Update the history variables
-    Fe_iter[cellID][quadPtID]=FE_tau;
-    Fp_iter[cellID][quadPtID]=FP_tau;
-    s_alpha_iter2[cellID][quadPtID]=sres_tau2;
+    // Update the history variables (scattered to the iteration history by calculatePlasticityBatch)
+    double* updatedHistory=batch.historyOut_ptr(p);
+    updatedHistory=packCellData(FE_tau,updatedHistory);
+    updatedHistory=packCellData(FP_tau,updatedHistory);
+    packCellData(sres_tau2,updatedHistory);
     
     
 }
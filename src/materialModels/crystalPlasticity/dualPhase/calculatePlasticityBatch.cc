@@ -0,0 +1,75 @@
+//batched constitutive update for the crystalPlasticity class
+//The points of the block may belong to several cells (see constitutiveBatch).
+//The converged history (Fe, Fp, rotation matrix, slip resistances of the phase
+//of the point) of the block is gathered into the batch once, the points are
+//updated one after the other with the same per-thread workspace (no heap
+//allocation across the block), and the updated history (Fe, Fp, slip
+//resistances) is scattered to the iteration history once. The history of a
+//point is sized for the phase with more slip systems. The slip system loops are
+//still per point. Returns the number of points that took the elastic fast path.
+//With the selective re-evaluation, points whose deformation gradient is within
+//reevaluationTolerance of the one of their last update take the stored stress
+//and tangent instead (counted in numReused); their history is neither gathered
+//nor scattered. The phase of each point selects its constitutive update.
+template <int dim>
+unsigned int crystalPlasticity<dim>::calculatePlasticityBatch(constitutiveBatch<dim> &batch,
+                                                              unsigned int &numReused)
+{
+    quadPointData &qpData=quadPointScratch.get();
+    unsigned int numElastic=0;
+    numReused=0;
+    const unsigned int n_slip=std::max(s_alpha_conv1.n_components(),s_alpha_conv2.n_components());
+    batch.reinitHistory(Fe_conv.n_components()+Fp_conv.n_components()+rotationMatrix.n_components()+n_slip,
+                        Fe_iter.n_components()+Fp_iter.n_components()+n_slip);
+    //the stored updates are only reused after the first iteration of an increment, where every
+    //point has been updated for the current converged history variables
+    const bool reuse=(reevaluationTolerance>=0.0) && (this->currentIteration>0);
+    for (unsigned int p=0; p<batch.size(); p++){
+        bool isElastic=false;
+        const bool reused=reuse && lastUpdate.lookup(batch.cellID(p), batch.quadPt(p), batch, p, reevaluationTolerance, isElastic);
+        batch.setUpdated(p,!reused);
+        if (reused){
+            numReused++;
+            if (isElastic) numElastic++;
+        }
+    }
+    //gather the converged history
+    for (unsigned int p=0; p<batch.size(); p++){
+        if (!batch.isUpdated(p)) continue;
+        const unsigned int cellID=batch.cellID(p), q=batch.quadPt(p);
+        double* history=batch.historyIn_ptr(p);
+        history=Fe_conv.pack(cellID,q,history);
+        history=Fp_conv.pack(cellID,q,history);
+        history=rotationMatrix.pack(cellID,q,history);
+        if(phaseID[cellID][q]==1)
+            s_alpha_conv1.pack(cellID,q,history);
+        else
+            s_alpha_conv2.pack(cellID,q,history);
+    }
+    //update
+    for (unsigned int p=0; p<batch.size(); p++){
+        if (!batch.isUpdated(p)) continue;
+        const unsigned int cellID=batch.cellID(p), q=batch.quadPt(p);
+        batch.getF(p,qpData.F);
+        if(phaseID[cellID][q]==1)
+            calculatePlasticity1(batch, p, qpData);
+        else
+            calculatePlasticity2(batch, p, qpData);
+        batch.setResults(p,qpData.P,qpData.T,qpData.dP_dF);
+        if (reevaluationTolerance>=0.0) lastUpdate.store(cellID, q, batch, p, qpData.elastic);
+        if (qpData.elastic) numElastic++;
+    }
+    //scatter the updated history
+    for (unsigned int p=0; p<batch.size(); p++){
+        if (!batch.isUpdated(p)) continue;
+        const unsigned int cellID=batch.cellID(p), q=batch.quadPt(p);
+        const double* updatedHistory=batch.historyOut_ptr(p);
+        updatedHistory=Fe_iter.unpack(cellID,q,updatedHistory);
+        updatedHistory=Fp_iter.unpack(cellID,q,updatedHistory);
+        if(phaseID[cellID][q]==1)
+            s_alpha_iter1.unpack(cellID,q,updatedHistory);
+        else
+            s_alpha_iter2.unpack(cellID,q,updatedHistory);
+    }
+    return numElastic;
+}
@@ -1,12 +1,10 @@
 
 template <int dim>
-void crystalPlasticity<dim>::inactive_slip_removal2(Vector<double> &active, Vector<double> &x_beta_old, Vector<double> &x_beta, int &n_PA, Vector<double> &PA, Vector<double> b,FullMatrix<double> A,FullMatrix<double> &A_PA){
+void crystalPlasticity<dim>::inactive_slip_removal2(Vector<double> &active, Vector<double> &x_beta_old, Vector<double> &x_beta, int &n_PA, Vector<double> &PA, const Vector<double> &b,const FullMatrix<double> &A,FullMatrix<double> &A_PA,activeSetSolver &slipSolver){
     
     Vector<double> inactive;
     
     FullMatrix<double> temp,temp2;
-    LAPACKFullMatrix<double> temp7;
-    temp7.reinit(n_PA,n_PA);
     int iter=0,iter1=0,iter2=0,iter3=0;
     Vector<double> x_beta1(n_PA), x_beta2(n_PA),b_PA(n_PA);
     double flag1=0;
@@ -16,15 +14,15 @@ void crystalPlasticity<dim>::inactive_slip_removal2(Vector<double> &active, Vect
         b_PA(i)=b(PA(i));
         for(unsigned int j=0;j<n_PA;j++){
             A_PA[i][j]=A[PA(i)][PA(j)];
-            temp7(i,j)=A[PA(i)][PA(j)];
             
         }
         
     }
     temp.reinit(n_PA,n_PA); temp2.reinit(n_PA,n_PA);
-    temp7.compute_inverse_svd(0.0);
-    Vector<double> tempv3;
-    temp7.vmult(x_beta1,b_PA);
+    //LU of the active set. If the active slip systems are linearly dependent, the minimum-norm
+    //solution of a complete orthogonal decomposition (the pseudo-inverse solution)
+    slipSolver.factorize(A_PA);
+    slipSolver.solve(b_PA,x_beta1);
     
     //Check for model tolerance and activate adaptive time-stepping, if required
     if(x_beta1.l2_norm()> modelMaxPlasticSlipL2Norm){
@@ -33,8 +31,14 @@ void crystalPlasticity<dim>::inactive_slip_removal2(Vector<double> &active, Vect
         char buffer[200];
         sprintf (buffer, "processor %u: time-step is very large. Consider reducing the time-step. current model norm: %12.6e, tolerance: %12.6e\n", this->triangulation.locally_owned_subdomain(), x_beta1.l2_norm(), modelMaxPlasticSlipL2Norm);
         std::cout <<buffer;
-        this->loadFactorSetByModel*=adaptiveLoadStepFactor;
-        this->resetIncrement=true;
+        {
+            //with multithreaded assembly only the first failing quadrature point reduces the load step
+            Threads::Mutex::ScopedLock lock(this->assemblyMutex);
+            if (!this->resetIncrement){
+                this->loadFactorSetByModel*=adaptiveLoadStepFactor;
+                this->resetIncrement=true;
+            }
+        }
         throw 0;
 #endif
 #endif
@@ -97,21 +101,19 @@ void crystalPlasticity<dim>::inactive_slip_removal2(Vector<double> &active, Vect
             A_PA.reinit(n_PA-n_IA_new,n_PA-n_IA_new); A_PA=0.0;
             b_PA.reinit(n_PA-n_IA_new); b_PA=0.0;
             
-            temp7.reinit((n_PA-n_IA_new),(n_PA-n_IA_new));
             for(unsigned int i=0;i<(n_PA-n_IA_new);i++){
                 b_PA(i)=b(PA(i));
                 for(unsigned int j=0;j<(n_PA-n_IA_new);j++){
                     A_PA[i][j]=A[PA(i)][PA(j)];
-                    temp7(i,j)=A[PA(i)][PA(j)];
                     
                 }
 
             }
             
             
-            temp7.compute_inverse_svd(0.0);
+            slipSolver.factorize(A_PA);
             
-            x_beta1.reinit(n_PA-n_IA_new); temp7.vmult(x_beta1,b_PA);
+            slipSolver.solve(b_PA,x_beta1);
             x_beta2.reinit(n_PA-n_IA_new); x_beta2=x_beta1;
             x_beta1.reinit(n_slip_systems2);x_beta1=0.0;
             n_PA=n_PA-n_IA_new;
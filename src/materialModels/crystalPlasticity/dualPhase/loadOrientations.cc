@@ -4,8 +4,23 @@ void crystalPlasticity<dim>::loadOrientations(){
     QGauss<dim>  quadrature(quadOrder);
     const unsigned int num_quad_points = quadrature.size();
     FEValues<dim> fe_values (this->FE, quadrature, update_quadrature_points);
-    //loop over elements
     typename DoFHandler<dim>::active_cell_iterator cell = this->dofHandler.begin_active(), endc = this->dofHandler.end();
+    //read the voxels of the box around the locally owned cell centers
+    double boxMin[3]={1.0, 1.0, 1.0}, boxMax[3]={0.0, 0.0, 0.0};
+    bool emptyBox=true;
+    for (; cell!=endc; ++cell) {
+        if (cell->is_locally_owned()){
+            const Point<dim> center=cell->center();
+            for (unsigned int i=0; i<dim; ++i){
+                boxMin[i]=emptyBox ? center[i] : std::min(boxMin[i], center[i]);
+                boxMax[i]=emptyBox ? center[i] : std::max(boxMax[i], center[i]);
+            }
+            emptyBox=false;
+        }
+    }
+    orientations.readLocalVoxels(boxMin, boxMax);
+    //loop over elements
+    cell = this->dofHandler.begin_active();
     for (; cell!=endc; ++cell) {
         if (cell->is_locally_owned()){
             quadratureOrientationsMap.push_back(std::vector<unsigned int>(num_quad_points,0));
@@ -44,4 +59,10 @@ void crystalPlasticity<dim>::loadOrientations(){
         }
     }
     
+    //read the orientations of the grains of the locally owned quadrature points
+    std::set<unsigned int> grainIDs;
+    for (unsigned int cellID=0; cellID<quadratureOrientationsMap.size(); ++cellID){
+        grainIDs.insert(quadratureOrientationsMap[cellID].begin(), quadratureOrientationsMap[cellID].end());
+    }
+    orientations.readLocalOrientations(grainIDs);
 }
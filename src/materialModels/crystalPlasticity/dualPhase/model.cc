@@ -1,15 +1,25 @@
 //constructor
 template <int dim>
 crystalPlasticity<dim>::crystalPlasticity() :
-ellipticBVP<dim>(),
-F(dim,dim),
-F_tau(dim,dim),
-FP_tau(dim,dim),
-FE_tau(dim,dim),
-T(dim,dim),
-P(dim,dim)
+ellipticBVP<dim>()
 {
     initCalled = false;
+    //getElementalValues can be called concurrently on different cells (see quadPointData)
+    ellipticBVP<dim>::multithreadedAssemblySupported=true;
+    //the history variables are transferred to the new mesh on refinement and repartitioning (see updateAfterMeshChange)
+    ellipticBVP<dim>::repartitionSupported=true;
+    //the elemental jacobian is assembled from dP_dF of the quadrature points (see storeQuadPointTangent)
+    ellipticBVP<dim>::matrixFreeTangentSupported=true;
+    //selective re-evaluation: reuse the stress and tangent of quadrature points whose deformation
+    //gradient did not change measurably since their last update (see calculatePlasticityBatch)
+    reevaluationTolerance=-1.0;
+#ifdef enableSelectiveReevaluation
+#ifdef reevaluationToleranceFactor
+    if (enableSelectiveReevaluation) reevaluationTolerance=reevaluationToleranceFactor*relNonLinearTolerance;
+#else
+    if (enableSelectiveReevaluation) reevaluationTolerance=0.01*relNonLinearTolerance;
+#endif
+#endif
     
     //post processing
     ellipticBVP<dim>::numPostProcessedFields=5;
@@ -35,6 +45,18 @@ void crystalPlasticity<dim>::getElementalValues(FEValues<dim>& fe_values,
     if(initCalled == false){
         init(num_quad_points);
     }
+
+    //per-thread quadrature point data
+    quadPointData &qpData=quadPointScratch.get();
+    FullMatrix<double> &F=qpData.F, &T=qpData.T, &P=qpData.P;
+    FullMatrix<double> &dP_dF=qpData.dP_dF;
+    //strain and deviators of the post-processed fields
+    FullMatrix<double> &CE_tau=qpData.CE_tau, &E_tau=qpData.E_tau, &deve=qpData.deve, &devt=qpData.devt;
+    //blocked stiffness kernel (see elementalStiffness.cc), otherwise the reference scalar loop
+    bool blockedKernel=false;
+#ifdef blockedStiffnessKernel
+    blockedKernel=blockedStiffnessKernel;
+#endif
     
     unsigned int cellID = fe_values.get_cell()->user_index();
     std::vector<unsigned int> local_dof_indices(dofs_per_cell);
@@ -51,12 +73,20 @@ void crystalPlasticity<dim>::getElementalValues(FEValues<dim>& fe_values,
     }
     
     //local data structures
-    FullMatrix<double> K_local(dofs_per_cell,dofs_per_cell),CE_tau(dim,dim),E_tau(dim,dim),temp,temp2,temp3;
+    FullMatrix<double> K_local(dofs_per_cell,dofs_per_cell);
     Vector<double> Rlocal (dofs_per_cell);
     K_local = 0.0; Rlocal = 0.0;
+    //volume weighted strain and stress of this cell
+    FullMatrix<double> cell_strain(dim,dim), cell_stress(dim,dim);
+    double cell_microvol=0.0;
     
     
-    //loop over quadrature points
+    //shape gradient table of the cell for the vectorized kernel
+    if (blockedKernel) qpData.stiffness.reinitCell(fe_values);
+
+    //deformation gradients of all quadrature points, then the batched constitutive update
+    constitutiveBatch<dim> &batch=qpData.batch;
+    batch.reinit(num_quad_points);
     for (unsigned int q=0; q<num_quad_points; ++q){
         //Get deformation gradient
         F=0.0;
@@ -69,72 +99,66 @@ void crystalPlasticity<dim>::getElementalValues(FEValues<dim>& fe_values,
         for (unsigned int i=0; i<dim; ++i){
             F[i][i]+=1;
         }
+        batch.setPoint(q,cellID,q);
+        batch.setF(q,F);
+    }
+    //Update strain, stress, and tangent for current time step/quadrature points
+    unsigned int cellReusedQuadPoints=0;
+    const unsigned int cellElasticQuadPoints=calculatePlasticityBatch(batch, cellReusedQuadPoints);
+
+    //loop over quadrature points
+    for (unsigned int q=0; q<num_quad_points; ++q){
+        //deformation gradient, stress and tangent of the quadrature point
+        batch.getF(q,F);
+        batch.getResults(q,P,T,dP_dF);
+        //tangent of the matrix-free operator (see ellipticBVP<dim>::storeQuadPointTangent)
+        if (this->matrixFreeTangent) this->storeQuadPointTangent(cellID, q, dP_dF, fe_values.JxW(q));
         
-        
-        //Update strain, stress, and tangent for current time step/quadrature point
-        
-        if(phaseID[cellID][q]==1)
-        calculatePlasticity1(cellID, q);
-        else
-            calculatePlasticity2(cellID, q);
-        
-        
-        //Fill local residual
-        for (unsigned int d=0; d<dofs_per_cell; ++d) {
-            unsigned int i = fe_values.get_fe().system_to_component_index(d).first;
-            for (unsigned int j = 0; j < dim; j++){
-                Rlocal(d) -=  fe_values.shape_grad(d, q)[j]*P[i][j]*fe_values.JxW(q);
+        //Fill local residual, or collect P and dP_dF for the vectorized kernel
+        if (blockedKernel){
+            qpData.stiffness.setQuadPointValues(q, P, dP_dF);
+        }
+        else{
+            for (unsigned int d=0; d<dofs_per_cell; ++d) {
+                unsigned int i = fe_values.get_fe().system_to_component_index(d).first;
+                for (unsigned int j = 0; j < dim; j++){
+                    Rlocal(d) -=  fe_values.shape_grad(d, q)[j]*P[i][j]*fe_values.JxW(q);
                 
                 
+                }
+                //if(q==7)
+                // this->pcout<<Rlocal(d)<<'\n';
             }
-            //if(q==7)
-            // this->pcout<<Rlocal(d)<<'\n';
         }
         
-        temp.reinit(dim,dim); temp=0.0;
-        temp2.reinit(dim,dim); temp2=0.0;
-        temp3.reinit(dim,dim); temp3=0.0;
-        CE_tau=0.0;
-        temp=F;
-        F.Tmmult(CE_tau,temp);
-        E_tau=CE_tau;
-        temp=IdentityMatrix(dim);
+        //Green-Lagrange strain E=(F^T F-I)/2, volume weighted strain and stress of the cell
+        F.Tmmult(CE_tau,F);
         for(unsigned int i=0;i<dim;i++){
             for(unsigned int j=0;j<dim;j++){
-                E_tau[i][j] = 0.5*(E_tau[i][j]-temp[i][j]);
-                temp2[i][j]=E_tau[i][j]*fe_values.JxW(q);
-                temp3[i][j]=T[i][j]*fe_values.JxW(q);
+                E_tau[i][j] = 0.5*(CE_tau[i][j]-(i==j));
+                cell_strain[i][j]+=E_tau[i][j]*fe_values.JxW(q);
+                cell_stress[i][j]+=T[i][j]*fe_values.JxW(q);
             }
         }
-        //cout<<E_tau[0][0]<<"\t"<<T[0][0]<<"\t"<<fe_values.JxW(q)<<"\n";
-        local_strain.add(1.0,temp2);
-        local_stress.add(1.0,temp3);
-        local_microvol=local_microvol+fe_values.JxW(q);
-        
+        cell_microvol=cell_microvol+fe_values.JxW(q);
+
+        //calculate von-Mises stress and equivalent strain from the deviatoric parts
         double traceE, traceT,vonmises,eqvstrain;
-        FullMatrix<double> deve(dim,dim),devt(dim,dim);
-        
-        
         traceE=E_tau.trace();
         traceT=T.trace();
-        temp=IdentityMatrix(3);
-        temp.equ(traceE/3,temp);
-        
         deve=E_tau;
-        deve.add(-1.0,temp);
-        
-        temp=IdentityMatrix(3);
-        temp.equ(traceT/3,temp);
-        
         devt=T;
-        devt.add(-1.0,temp);
-        
+        for(unsigned int i=0;i<dim;i++){
+            deve[i][i]-=traceE/3;
+            devt[i][i]-=traceT/3;
+        }
+
         vonmises= devt.frobenius_norm();
         vonmises=sqrt(3.0/2.0)*vonmises;
         eqvstrain=deve.frobenius_norm();
         eqvstrain=sqrt(2.0/3.0)*eqvstrain;
-        
-        
+
+
         //fill in post processing field values
         
         this->postprocessValues(cellID, q, 0, 0)=vonmises;
@@ -148,24 +172,38 @@ void crystalPlasticity<dim>::getElementalValues(FEValues<dim>& fe_values,
         
         std::cout.precision(3);
         
-        //evaluate elemental stiffness matrix, K_{ij} = N_{i,k}*C_{mknl}*F_{im}*F{jn}*N_{j,l} + N_{i,k}*F_{kl}*N_{j,l}*del{ij} dV 
-        for (unsigned int d1=0; d1<dofs_per_cell; ++d1) {
-            unsigned int i = fe_values.get_fe().system_to_component_index(d1).first;
-            for (unsigned int d2=0; d2<dofs_per_cell; ++d2) {
-                unsigned int j = fe_values.get_fe().system_to_component_index(d2).first;
-                for (unsigned int k = 0; k < dim; k++){
-                    for (unsigned int l= 0; l< dim; l++){
-                        K_local(d1,d2) +=  fe_values.shape_grad(d1, q)[k]*dP_dF[i][k][j][l]*fe_values.shape_grad(d2, q)[l]*fe_values.JxW(q);
+        //evaluate elemental stiffness matrix, K_{d1d2} = N_{d1,k}*dP_dF_{ikjl}*N_{d2,l} dV, with the compact tangent dP_dF(dim*i+k,dim*j+l)
+        if (!blockedKernel){
+            for (unsigned int d1=0; d1<dofs_per_cell; ++d1) {
+                unsigned int i = fe_values.get_fe().system_to_component_index(d1).first;
+                for (unsigned int d2=0; d2<dofs_per_cell; ++d2) {
+                    unsigned int j = fe_values.get_fe().system_to_component_index(d2).first;
+                    for (unsigned int k = 0; k < dim; k++){
+                        for (unsigned int l= 0; l< dim; l++){
+                            K_local(d1,d2) +=  fe_values.shape_grad(d1, q)[k]*dP_dF(dim*i+k,dim*j+l)*fe_values.shape_grad(d2, q)[l]*fe_values.JxW(q);
                         
+                        }
                     }
+                    //if(q==7)
+                    //this->pcout<<K_local(d1,d2)<<'\t';
                 }
                 //if(q==7)
-                //this->pcout<<K_local(d1,d2)<<'\t';
+                //this->pcout<<'\n';
             }
-            //if(q==7)
-            //this->pcout<<'\n';
         }
     }
+    //residual and stiffness of all quadrature points (vectorized kernel)
+    if (blockedKernel) qpData.stiffness.assemble(K_local, Rlocal);
+    //add to the per-core totals (shared between threads)
+    {
+        Threads::Mutex::ScopedLock lock(this->assemblyMutex);
+        local_strain.add(1.0,cell_strain);
+        local_stress.add(1.0,cell_stress);
+        local_microvol=local_microvol+cell_microvol;
+        local_elasticQuadPoints+=cellElasticQuadPoints;
+        local_plasticQuadPoints+=num_quad_points-cellElasticQuadPoints;
+        local_reusedQuadPoints+=cellReusedQuadPoints;
+    }
     elementalJacobian = K_local;
     elementalResidual = Rlocal;
 }
@@ -175,22 +213,157 @@ void crystalPlasticity<dim>::getElementalValues(FEValues<dim>& fe_values,
  template <int dim>
  void crystalPlasticity<dim>::updateBeforeIteration()
  {
+     //initialize history variables before the first assembly, as getElementalValues
+     //may be called concurrently from several threads (multithreaded assembly)
+     if(initCalled == false){
+         QGauss<dim>  quadrature(quadOrder);
+         init(quadrature.size());
+     }
      local_strain=0.0;
      local_stress=0.0;
      local_microvol=0.0;
+     local_elasticQuadPoints=0;
+     local_plasticQuadPoints=0;
+     local_reusedQuadPoints=0;
 
      //call base class project() function to project post processed fields
      //ellipticBVP<dim>::project();
  }
 
+ template <int dim>
+ void crystalPlasticity<dim>::updateAfterAssembly()
+ {
+     //share of the quadrature points that took the elastic fast path in this assembly
+     const unsigned int numElastic=Utilities::MPI::sum(local_elasticQuadPoints,this->mpi_communicator);
+     const unsigned int numPlastic=Utilities::MPI::sum(local_plasticQuadPoints,this->mpi_communicator);
+     if (numElastic+numPlastic==0) return;
+     char buffer[200];
+     sprintf(buffer, "constitutive update: %u elastic, %u plastic quadrature points (%5.1f%% elastic)\n", numElastic, numPlastic, 100.0*numElastic/(numElastic+numPlastic));
+     this->pcout << buffer;
+     //quadrature points skipped by the selective re-evaluation (counted above with their stored state)
+     if (reevaluationTolerance>=0.0){
+         const unsigned int numReused=Utilities::MPI::sum(local_reusedQuadPoints,this->mpi_communicator);
+         sprintf(buffer, "selective re-evaluation: %u of %u quadrature points reused (%5.1f%%)\n", numReused, numElastic+numPlastic, 100.0*numReused/(numElastic+numPlastic));
+         this->pcout << buffer;
+     }
+ }
+
  template <int dim>
  void crystalPlasticity<dim>::updateBeforeIncrement()
  {
      microvol=0.0;
+     //the stored constitutive updates belong to the converged history variables of the previous
+     //increment (or of a reset attempt), so every point is updated again in the first iteration
+     lastUpdate.invalidate();
      //call base class project() function to project post processed fields
      //ellipticBVP<dim>::project();
  }
 
+ //load reversal marker, written to and read from a checkpoint (see ellipticBVP<dim>::writeCheckpoint).
+ //The history variables of the quadrature points are stored with the mesh (see historyDataSize)
+ template <int dim>
+ void crystalPlasticity<dim>::writeCheckpointData(std::ostream& out)
+ {
+     checkpointWrite(out, signstress);
+ }
+
+ template <int dim>
+ void crystalPlasticity<dim>::readCheckpointData(std::istream& in)
+ {
+     checkpointRead(in, signstress);
+ }
+
+
+
+//history variables transferred to the new mesh per quadrature point (see ellipticBVP<dim>::updateMesh):
+//the converged history variables, the orientations and the grain IDs of the quadrature points
+template <int dim>
+unsigned int crystalPlasticity<dim>::historyDataSize()
+{
+    //the layout of the history variables is set on the first assembly
+    if(initCalled == false){
+        QGauss<dim>  quadrature(quadOrder);
+        init(quadrature.size());
+    }
+    //history variables of the quadrature point (twin and phaseID are one value each), then its grain ID
+    return Fp_conv.n_components()+Fe_conv.n_components()+s_alpha_conv1.n_components()+s_alpha_conv2.n_components()+rot.n_components()+rotnew.n_components()+numTwinSystems+numSlipSystems1+numSlipSystems2+2+1;
+}
+
+template <int dim>
+void crystalPlasticity<dim>::packHistoryData(const unsigned int cellID, const unsigned int q, double* data)
+{
+    data=Fp_conv.pack(cellID,q,data);
+    data=Fe_conv.pack(cellID,q,data);
+    data=s_alpha_conv1.pack(cellID,q,data);
+    data=s_alpha_conv2.pack(cellID,q,data);
+    data=rot.pack(cellID,q,data);
+    data=rotnew.pack(cellID,q,data);
+    data=packCellData(twinfraction_conv[cellID][q],data);
+    data=packCellData(slipfraction_conv1[cellID][q],data);
+    data=packCellData(slipfraction_conv2[cellID][q],data);
+    data=packCellData(twin[cellID][q],data);
+    data=packCellData(phaseID[cellID][q],data);
+    packCellData(quadratureOrientationsMap[cellID][q],data);
+}
+
+template <int dim>
+void crystalPlasticity<dim>::reinitHistoryData(const unsigned int numLocalCells)
+{
+    const unsigned int num_quad_points=rot.n_quadrature_points();
+    Fp_conv.resizeCells(numLocalCells);
+    Fe_conv.resizeCells(numLocalCells);
+    s_alpha_conv1.resizeCells(numLocalCells);
+    s_alpha_conv2.resizeCells(numLocalCells);
+    rot.resizeCells(numLocalCells);
+    rotnew.resizeCells(numLocalCells);
+    twinfraction_conv.assign(numLocalCells,std::vector<vector<double> >(num_quad_points,vector<double>(numTwinSystems)));
+    slipfraction_conv1.assign(numLocalCells,std::vector<vector<double> >(num_quad_points,vector<double>(numSlipSystems1)));
+    slipfraction_conv2.assign(numLocalCells,std::vector<vector<double> >(num_quad_points,vector<double>(numSlipSystems2)));
+    twin.assign(numLocalCells,std::vector<double>(num_quad_points));
+    phaseID.assign(numLocalCells,std::vector<double>(num_quad_points));
+    quadratureOrientationsMap.assign(numLocalCells,std::vector<unsigned int>(num_quad_points));
+}
+
+template <int dim>
+void crystalPlasticity<dim>::unpackHistoryData(const unsigned int cellID, const unsigned int q, const double* data)
+{
+    data=Fp_conv.unpack(cellID,q,data);
+    data=Fe_conv.unpack(cellID,q,data);
+    data=s_alpha_conv1.unpack(cellID,q,data);
+    data=s_alpha_conv2.unpack(cellID,q,data);
+    data=rot.unpack(cellID,q,data);
+    data=rotnew.unpack(cellID,q,data);
+    data=unpackCellData(twinfraction_conv[cellID][q],data);
+    data=unpackCellData(slipfraction_conv1[cellID][q],data);
+    data=unpackCellData(slipfraction_conv2[cellID][q],data);
+    data=unpackCellData(twin[cellID][q],data);
+    data=unpackCellData(phaseID[cellID][q],data);
+    unpackCellData(quadratureOrientationsMap[cellID][q],data);
+}
+
+template <int dim>
+void crystalPlasticity<dim>::updateAfterMeshChange()
+{
+    //iteration values start from the converged ones, as after an increment
+    Fp_iter=Fp_conv;
+    Fe_iter=Fe_conv;
+    s_alpha_iter1=s_alpha_conv1;
+    s_alpha_iter2=s_alpha_conv2;
+    twinfraction_iter=twinfraction_conv;
+    slipfraction_iter1=slipfraction_conv1;
+    slipfraction_iter2=slipfraction_conv2;
+    //rotation matrices of the transferred orientations
+    rotationMatrix.resizeCells(rot.n_cells());
+    for (unsigned int cellID=0; cellID<rot.n_cells(); cellID++){
+        for (unsigned int q=0; q<rot.n_quadrature_points(); q++){
+            updateRotationMatrix(cellID,q);
+        }
+    }
+    //stored constitutive updates of the selective re-evaluation
+    if (reevaluationTolerance>=0.0){
+        lastUpdate.reinit(rot.n_cells(),rot.n_quadrature_points());
+    }
+}
 
 
 //implementation of the getElementalValues method
@@ -204,8 +377,9 @@ void crystalPlasticity<dim>::updateAfterIncrement()
      slipfraction_conv2=slipfraction_iter2;
     
     
-    //copy rotnew to output
-    orientations.outputOrientations.clear();
+    //copy rotnew to output (every orientationsOutputStride increments)
+    const bool writeOrientations=orientations.isOutputIncrement(this->currentIncrement, this->isLastIncrement());
+    if (writeOrientations) orientations.outputOrientations.clear();
     QGauss<dim>  quadrature(quadOrder);
     const unsigned int num_quad_points = quadrature.size();
     FEValues<dim> fe_values (this->FE, quadrature, update_quadrature_points | update_JxW_values);
@@ -217,17 +391,18 @@ void crystalPlasticity<dim>::updateAfterIncrement()
             fe_values.reinit(cell);
             //loop over quadrature points
             for (unsigned int q=0; q<num_quad_points; ++q){
-                std::vector<double> temp;
-                temp.push_back(fe_values.get_quadrature_points()[q][0]);
-                temp.push_back(fe_values.get_quadrature_points()[q][1]);
-                temp.push_back(fe_values.get_quadrature_points()[q][2]);
-                temp.push_back(rotnew[cellID][q][0]);
-                temp.push_back(rotnew[cellID][q][1]);
-                temp.push_back(rotnew[cellID][q][2]);
-                temp.push_back(fe_values.JxW(q));
-                temp.push_back(quadratureOrientationsMap[cellID][q]);
-
-                orientations.addToOutputOrientations(temp);
+                if (writeOrientations){
+                    std::vector<double> temp;
+                    temp.push_back(fe_values.get_quadrature_points()[q][0]);
+                    temp.push_back(fe_values.get_quadrature_points()[q][1]);
+                    temp.push_back(fe_values.get_quadrature_points()[q][2]);
+                    temp.push_back(rotnew(cellID,q)[0]);
+                    temp.push_back(rotnew(cellID,q)[1]);
+                    temp.push_back(rotnew(cellID,q)[2]);
+                    temp.push_back(fe_values.JxW(q));
+                    temp.push_back(quadratureOrientationsMap[cellID][q]);
+                    orientations.addToOutputOrientations(temp);
+                }
                 local_F_e=local_F_e+twin[cellID][q]*fe_values.JxW(q);
                 for(unsigned int i=0;i<numTwinSystems;i++){
                     local_F_r=local_F_r+twinfraction_conv[cellID][q][i]*fe_values.JxW(q);
@@ -237,13 +412,15 @@ void crystalPlasticity<dim>::updateAfterIncrement()
             cellID++;
         }
     }
-    orientations.writeOutputOrientations();
+    if (writeOrientations) orientations.writeOutputOrientations();
     
-    //Update the history variables when convergence is reached for the current increment
-    Fe_conv=Fe_iter;
-    Fp_conv=Fp_iter;
-    s_alpha_conv1=s_alpha_iter1;
-    s_alpha_conv2=s_alpha_iter2;
+    //Update the history variables when convergence is reached for the current increment.
+    //The buffers are swapped instead of copied: the old converged values left in the
+    //iter buffers are overwritten at every quadrature point in the next calculatePlasticity
+    Fe_conv.swap(Fe_iter);
+    Fp_conv.swap(Fp_iter);
+    s_alpha_conv1.swap(s_alpha_iter1);
+    s_alpha_conv2.swap(s_alpha_iter2);
     
     //double temp4,temp5;
     //temp4=Lambda[0][0];
@@ -323,15 +500,15 @@ void crystalPlasticity<dim>::updateAfterIncrement()
                     
                     FullMatrix<double> FE_t(dim,dim), FP_t(dim,dim),Twin_T(dim,dim),temp(dim,dim);
                     
-                    FE_t=Fe_conv[cellID][q];
-                    FP_t=Fp_conv[cellID][q];
+                    Fe_conv.get(cellID,q,FE_t);
+                    Fp_conv.get(cellID,q,FP_t);
                     
                     
                     Twin_image(twin_pos,cellID,q);
-                    double s_alpha_twin=s_alpha_conv2[cellID][q][numSlipSystems2+twin_pos];
+                    double s_alpha_twin=s_alpha_conv2(cellID,q)[numSlipSystems2+twin_pos];
                     for(unsigned int i=0;i<numTwinSystems;i++){
                         twinfraction_conv[cellID][q][i]=0;
-                        s_alpha_conv2[cellID][q][numSlipSystems2+twin_pos]=s_alpha_twin;
+                        s_alpha_conv2(cellID,q)[numSlipSystems2+twin_pos]=s_alpha_twin;
                         
                     }
                     
@@ -356,8 +533,8 @@ void crystalPlasticity<dim>::updateAfterIncrement()
                     FP_t.mmult(temp,Twin_T);
                     Twin_T.mmult(FP_t,temp);
                     
-                    Fe_conv[cellID][q]=FE_t;
-                    Fp_conv[cellID][q]=FP_t;
+                    Fe_conv.set(cellID,q,FE_t);
+                    Fp_conv.set(cellID,q,FP_t);
                     
  
 		  if(twin[cellID][q]>0.0){
@@ -388,7 +565,7 @@ void crystalPlasticity<dim>::Twin_image(double twin_pos,unsigned int cellID,
                                         unsigned int quadPtID)
 {
     Vector<double> quat1(4),rod(3),quat2(4),quatprod(4);
-    rod(0) = rot[cellID][quadPtID][0];rod(1) = rot[cellID][quadPtID][1];rod(2) = rot[cellID][quadPtID][2];
+    rod(0) = rot(cellID,quadPtID)[0];rod(1) = rot(cellID,quadPtID)[1];rod(2) = rot(cellID,quadPtID)[2];
     
     rod2quat(quat2,rod);
     
@@ -402,8 +579,9 @@ void crystalPlasticity<dim>::Twin_image(double twin_pos,unsigned int cellID,
     
     //this->pcout<<rod(0)<<'\t'<<rod(1)<<'\t'<<rod(2)<<'\n';
     
-    rot[cellID][quadPtID][0]=rod(0);rot[cellID][quadPtID][1]=rod(1);rot[cellID][quadPtID][2]=rod(2);
-    rotnew[cellID][quadPtID][0]=rod(0);rotnew[cellID][quadPtID][1]=rod(1);rotnew[cellID][quadPtID][2]=rod(2);
+    rot(cellID,quadPtID)[0]=rod(0);rot(cellID,quadPtID)[1]=rod(1);rot(cellID,quadPtID)[2]=rod(2);
+    updateRotationMatrix(cellID,quadPtID);
+    rotnew(cellID,quadPtID)[0]=rod(0);rotnew(cellID,quadPtID)[1]=rod(1);rotnew(cellID,quadPtID)[2]=rod(2);
     
     
 }
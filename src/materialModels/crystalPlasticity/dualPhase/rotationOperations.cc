@@ -1,6 +1,6 @@
 
 template <int dim>
-void crystalPlasticity<dim>::odfpoint(FullMatrix <double> &OrientationMatrix,Vector<double> r) {
+void crystalPlasticity<dim>::odfpoint(FullMatrix <double> &OrientationMatrix,const Vector<double> &r) {
     
     
     //function OrientationMatrix = odfpoint(r)
@@ -48,3 +48,18 @@ void crystalPlasticity<dim>::odfpoint(FullMatrix <double> &OrientationMatrix,Vec
     
     
 }
+
+//refresh the cached rotation matrix of a quadrature point from its crystal orientation
+//(Rodrigues vector rot). Called whenever rot is changed (init and twin reorientation),
+//so that calculatePlasticity and reorient do not evaluate odfpoint at every call
+template <int dim>
+void crystalPlasticity<dim>::updateRotationMatrix(unsigned int cellID, unsigned int quadPtID) {
+    
+    FullMatrix<double> rotmat(dim,dim);
+    Vector<double> rot1(dim);
+    
+    rot.get(cellID,quadPtID,rot1);
+    odfpoint(rotmat,rot1);
+    rotationMatrix.set(cellID,quadPtID,rotmat);
+    
+}
@@ -131,7 +131,7 @@ void crystalPlasticity<dim>::symmf(FullMatrix<double> &A, FullMatrix<double> elm
 
 
 template <int dim>
-Vector<double> crystalPlasticity<dim>::vecform(FullMatrix<double> A) {
+Vector<double> crystalPlasticity<dim>::vecform(const FullMatrix<double> &A) {
     
     Vector<double> Av(6);
     
@@ -146,7 +146,21 @@ Vector<double> crystalPlasticity<dim>::vecform(FullMatrix<double> A) {
 }
 
 template <int dim>
-void crystalPlasticity<dim>::matform(FullMatrix<double> &A, Vector<double> Av) {
+void crystalPlasticity<dim>::vecform(const FullMatrix<double> &A, Vector<double> &Av) {
+    
+    Av.reinit(6);
+    
+    Av(0) =A[0][0];
+    Av(1) =A[1][1];
+    Av(2) =A[2][2];
+    Av(3) =A[1][2];
+    Av(4) =A[0][2];
+    Av(5) =A[0][1];
+    
+}
+
+template <int dim>
+void crystalPlasticity<dim>::matform(FullMatrix<double> &A, const Vector<double> &Av) {
     
     A.reinit(dim,dim);
     
@@ -163,26 +177,76 @@ void crystalPlasticity<dim>::matform(FullMatrix<double> &A, Vector<double> Av) {
 }
 
 template <int dim>
-FullMatrix<double> crystalPlasticity<dim>::matrixExponential(FullMatrix<double> A) {
+void crystalPlasticity<dim>::matrixExponential(const FullMatrix<double> &A, FullMatrix<double> &expA) {
+    
+    //scaling and squaring on stack arrays: A is scaled by 2^-s such that |A/2^s|<=0.5, the
+    //Taylor series of exp(A/2^s) is summed with the tolerance of the former series
+    //implementation, and the result is squared s times. For the small plastic increments
+    //del_FP no scaling is needed and the series converges in a few terms
+    double a[dim][dim],term[dim][dim],prod[dim][dim],matExp[dim][dim];
+    double norm=0.0;
+    for(unsigned int i=0;i<dim;i++){
+        for(unsigned int j=0;j<dim;j++){
+            a[i][j]=A(i,j);
+            norm+=A(i,j)*A(i,j);
+        }
+    }
+    norm=std::sqrt(norm);
+    
+    unsigned int numSquarings=0;
+    if(norm>0.5){
+        numSquarings=(unsigned int)std::ceil(std::log(norm/0.5)/std::log(2.0));
+        const double scale=std::pow(2.0,-(double)numSquarings);
+        for(unsigned int i=0;i<dim;i++)
+            for(unsigned int j=0;j<dim;j++)
+                a[i][j]*=scale;
+    }
     
-    FullMatrix<double> matExp(dim,dim),temp(dim,dim),temp2(dim,dim);
-    matExp=IdentityMatrix(dim);
-    temp=IdentityMatrix(dim);
+    for(unsigned int i=0;i<dim;i++){
+        for(unsigned int j=0;j<dim;j++){
+            matExp[i][j]=(i==j)?1.0:0.0;
+            term[i][j]=matExp[i][j];
+        }
+    }
     
-    double count=1;
+    //term_k=term_(k-1)*a/k, stop once |term_k|<=1e-15
+    for(unsigned int count=1;count<=30;count++){
+        double termNorm=0.0;
+        for(unsigned int i=0;i<dim;i++){
+            for(unsigned int j=0;j<dim;j++){
+                prod[i][j]=0.0;
+                for(unsigned int k=0;k<dim;k++)
+                    prod[i][j]+=term[i][k]*a[k][j];
+            }
+        }
+        for(unsigned int i=0;i<dim;i++){
+            for(unsigned int j=0;j<dim;j++){
+                term[i][j]=prod[i][j]/count;
+                matExp[i][j]+=term[i][j];
+                termNorm+=term[i][j]*term[i][j];
+            }
+        }
+        if(termNorm<=1.0e-30) break;
+    }
     
-    while(temp.frobenius_norm()>1e-15){
-        
-        temp.mmult(temp2,A);
-        temp2.equ(1/count,temp2);
-        temp.equ(1.0,temp2);
-        matExp.add(1.0,temp);
-        count=count+1.0;
-        
-        
+    //exp(A)=exp(A/2^s)^(2^s)
+    for(unsigned int s=0;s<numSquarings;s++){
+        for(unsigned int i=0;i<dim;i++){
+            for(unsigned int j=0;j<dim;j++){
+                prod[i][j]=0.0;
+                for(unsigned int k=0;k<dim;k++)
+                    prod[i][j]+=matExp[i][k]*matExp[k][j];
+            }
+        }
+        for(unsigned int i=0;i<dim;i++)
+            for(unsigned int j=0;j<dim;j++)
+                matExp[i][j]=prod[i][j];
     }
     
-    return matExp;
+    expA.reinit(dim,dim);
+    for(unsigned int i=0;i<dim;i++)
+        for(unsigned int j=0;j<dim;j++)
+            expA(i,j)=matExp[i][j];
     
 }
 
@@ -5,6 +5,11 @@
 //dealii headers
 #include "../../../../include/ellipticBVP.h"
 #include "../../../../src/utilityObjects/crystalOrientationsIO.cc"
+#include "../../../../src/utilityObjects/quadratureHistory.cc"
+#include "../../../../src/utilityObjects/activeSetSolver.cc"
+#include "../../../../src/utilityObjects/elementalStiffness.cc"
+#include "../../../../src/utilityObjects/constitutiveBatch.cc"
+#include "../../../../src/utilityObjects/constitutiveCache.cc"
 #include <iostream>
 #include <fstream>
 
@@ -61,7 +66,17 @@ public:
     */
      
 
-    void inactive_slip_removal(Vector<double> &active,Vector<double> &x_beta_old, Vector<double> &x_beta, int &n_PA, Vector<double> &PA, Vector<double> b,FullMatrix<double> A,FullMatrix<double> &A_PA);
+    void inactive_slip_removal(Vector<double> &active,Vector<double> &x_beta_old, Vector<double> &x_beta, int &n_PA, Vector<double> &PA, const Vector<double> &b,const FullMatrix<double> &A,FullMatrix<double> &A_PA,activeSetSolver &slipSolver);
+    /**
+     *batched constitutive update: updates the stress and tangent modulus of the quadrature points
+     stored in batch (cell and quadrature point set per point, the block may span several cells),
+     for the deformation gradients stored in batch. The history of the block is gathered into
+     batch before and scattered from batch after the update. The stresses (P, T) and compact
+     tangents (dP_dF) are returned in batch. Returns the number of points that took the elastic
+     fast path. numReused is the number of points whose stored results were reused (selective
+     re-evaluation, see lastUpdate)
+     */
+    unsigned int calculatePlasticityBatch(constitutiveBatch<dim> &batch, unsigned int &numReused);
     /**
      * Structure to hold material parameters
      */
@@ -69,17 +84,21 @@ public:
     //orientation maps
     crystalOrientationsIO<dim> orientations;
 private:
+    struct quadPointData;
     void init(unsigned int num_quad_points);
     void setBoundaryValues(const Point<dim>& node, const unsigned int dof, bool& flag, double& value);
     /**
      * Updates the stress and tangent modulus at a given quadrature point in a element for
      * the given constitutive model. Takes the deformation gradient at the current nonlinear
      * iteration and the elastic and plastic deformation gradient of the previous time step to 
-     *calculate the stress and tangent modulus
+     *calculate the stress and tangent modulus. p is the point of the batch, whose gathered
+     *history is read and whose updated history is written. qpData is the per-thread quadrature
+     *point data (F in, P, T and dP_dF out)
      */
     
-    void calculatePlasticity(unsigned int cellID,
-                             unsigned int quadPtID);
+    void calculatePlasticity(constitutiveBatch<dim> &batch,
+                             unsigned int p,
+                             quadPointData &qpData);
     void getElementalValues(FEValues<dim>& fe_values,
                             unsigned int dofs_per_cell,
                             unsigned int num_quad_points,
@@ -87,21 +106,37 @@ private:
                             Vector<double>&     elementalResidual);
     void updateAfterIncrement();
     void updateBeforeIteration();
+    void updateAfterAssembly();
     void updateBeforeIncrement();
+    void writeCheckpointData(std::ostream& out);
+    void readCheckpointData(std::istream& in);
+    unsigned int historyDataSize();
+    void packHistoryData(const unsigned int cellID, const unsigned int q, double* data);
+    void reinitHistoryData(const unsigned int numLocalCells);
+    void unpackHistoryData(const unsigned int cellID, const unsigned int q, const double* data);
+    void updateAfterMeshChange();
     
     
     /**
      *calculates the rotation matrix (OrientationMatrix) from the rodrigues vector (r)
      */
-    void odfpoint(FullMatrix <double> &OrientationMatrix,Vector<double> r);
+    void odfpoint(FullMatrix <double> &OrientationMatrix,const Vector<double> &r);
+    /**
+     *refreshes the cached rotation matrix (rotationMatrix) of a quadrature point from rot
+     */
+    void updateRotationMatrix(unsigned int cellID, unsigned int quadPtID);
     /**
      *calculates the vector form (Voigt Notation) of the symmetric matrix A
      */
-    Vector<double> vecform(FullMatrix<double> A);
+    Vector<double> vecform(const FullMatrix<double> &A);
+    /**
+     *calculates the vector form (Voigt Notation) of the symmetric matrix A into Av, without allocating a new vector
+     */
+    void vecform(const FullMatrix<double> &A, Vector<double> &Av);
     /**
      *calculates the symmetric matrix (A) from the vector form Av (Voigt Notation)
      */
-    void matform(FullMatrix<double> &A, Vector<double> Av);
+    void matform(FullMatrix<double> &A, const Vector<double> &Av);
     
     /**
      *calculates the equivalent matrix Aright for the second order tensorial operation XA=B => A_r*{x}={b}
@@ -129,36 +164,91 @@ private:
     void tracev(FullMatrix<double> &Atrace, FullMatrix<double> elm, FullMatrix<double> B);
     
     /**
-     *calculates the matrix exponential of matrix A
+     *calculates the matrix exponential of the 3x3 matrix A (written into expA)
      */
     
-    FullMatrix<double> matrixExponential(FullMatrix<double> A);
+    void matrixExponential(const FullMatrix<double> &A, FullMatrix<double> &expA);
     
     
     /**
-     * Global deformation gradient F
-    */
-    FullMatrix<double> F;
-    /**
-     * Deformation gradient in crystal plasticity formulation. By default F=F_tau
-     */
-    FullMatrix<double> F_tau;
-    /**
-     * Plastic deformation gradient in crystal plasticity formulation. F_tau=Fe_tau*Fp_tau
-     */
-    FullMatrix<double> FP_tau;
-    /**
-     * Elastic deformation gradient in crystal plasticity formulation. F_tau=Fe_tau*Fp_tau
-     */
-    FullMatrix<double> FE_tau;
-    /**
-     * Cauchy Stress T
-     */
-    FullMatrix<double> T;
-    /**
-     * First Piola-Kirchhoff stress
-     */
-    FullMatrix<double> P;
+     * Work arrays of calculatePlasticity, kept per thread in quadPointData. They are only
+     * resized from one quadrature point to the next, so that the constitutive update does
+     * not allocate heap memory once the arrays have reached their final size.
+     */
+    struct plasticityWorkspace{
+        FullMatrix<double> FE_t,FP_t,rotmat,temp,temp1,temp2,temp3,temp4,temp5,temp6,CE_exp_FP;
+        FullMatrix<double> T_tau,P_tau,Fpn_inv,FE_tau_trial,F_trial,CE_tau_trial,FP_t2,Ee_tau_trial;
+        FullMatrix<double> h_alpha_beta_t,A,del_FP,A_PA,PK1_Stiff,delFp_delF,delFp_delF2,delFp_delF_prev;
+        FullMatrix<double> dels_delF,dels_delF_prev,A2,delFe_delF,delEtrial_delF,deltau_delF,delT_delF,delb_delF,delgamma_delF,S_PA;
+        FullMatrix<double> A_ds,delgamma_delF2,delTstar_delF,Ce_tau,T_star_tau,T_star_tau_trial,diff_FP,term_ds,PK_Stiff5,L;
+        FullMatrix<double> LL,PK_Stiff_LL,elasticM,elasticN,temp7;
+        Vector<double> s_alpha_t,s_alpha_tau,s_beta,h_beta,delh_beta_dels;
+        Vector<double> active,PA,PA_temp,resolved_shear_tau_trial,b,resolved_shear_tau,x_beta_old,x_beta,tempv1,tempv2;
+        Vector<double> b_PA,tempv3;
+        activeSetSolver slipSolver;
+    };
+    /**
+     * Quadrature point data exchanged between getElementalValues and calculatePlasticity.
+     * Kept per thread (quadPointScratch), so that cells can be assembled concurrently.
+     */
+    struct quadPointData{
+        quadPointData(): F(dim,dim), F_tau(dim,dim), FP_tau(dim,dim), FE_tau(dim,dim), T(dim,dim), P(dim,dim), dP_dF(dim*dim,dim*dim), elastic(false),
+            CE_tau(dim,dim), E_tau(dim,dim), deve(dim,dim), devt(dim,dim) {}
+        /**
+         * Global deformation gradient F
+         */
+        FullMatrix<double> F;
+        /**
+         * Deformation gradient in crystal plasticity formulation. By default F=F_tau
+         */
+        FullMatrix<double> F_tau;
+        /**
+         * Plastic deformation gradient in crystal plasticity formulation. F_tau=Fe_tau*Fp_tau
+         */
+        FullMatrix<double> FP_tau;
+        /**
+         * Elastic deformation gradient in crystal plasticity formulation. F_tau=Fe_tau*Fp_tau
+         */
+        FullMatrix<double> FE_tau;
+        /**
+         * Cauchy Stress T
+         */
+        FullMatrix<double> T;
+        /**
+         * First Piola-Kirchhoff stress
+         */
+        FullMatrix<double> P;
+        /**
+         * Tangent modulus dPK1/dF in compact form, dP_dF(dim*i+k,dim*j+l)=dP_ik/dF_jl
+         */
+        FullMatrix<double> dP_dF;
+        /**
+         * true if the last update took the elastic fast path (no active slip system)
+         */
+        bool elastic;
+        /**
+         * Right Cauchy-Green tensor, Green-Lagrange strain and deviatoric strain and stress
+         * of the post-processed fields (getElementalValues)
+         */
+        FullMatrix<double> CE_tau, E_tau, deve, devt;
+        /**
+         * slip resistance
+         */
+        Vector<double> sres_tau;
+        /**
+         * Work arrays of calculatePlasticity
+         */
+        plasticityWorkspace work;
+        /**
+         * Blocked elemental stiffness kernel
+         */
+        elementalStiffness<dim> stiffness;
+        /**
+         * Deformation gradients, stresses and tangents of the quadrature points of a cell
+         */
+        constitutiveBatch<dim> batch;
+    };
+    Threads::ThreadLocalStorage<quadPointData> quadPointScratch;
     
     /**
      * volume weighted Cauchy stress per core
@@ -177,11 +267,6 @@ private:
      */
     FullMatrix<double> global_strain;
     
-    /**
-     * Tangent modulus dPK1/dF
-     */
-    Tensor<4,dim,double> dP_dF;
-    
     /**
      * No. of elements
      */
@@ -194,6 +279,23 @@ private:
      * volume of elements per core
      */
     double local_microvol;
+    /**
+     * number of quadrature points per core that took the elastic fast path or the slip system
+     * search in the current assembly
+     */
+    unsigned int local_elasticQuadPoints, local_plasticQuadPoints;
+    /**
+     * number of quadrature points per core whose stored constitutive update was reused in the current assembly
+     */
+    unsigned int local_reusedQuadPoints;
+    /**
+     * Results of the last constitutive update of each quadrature point (selective re-evaluation)
+     */
+    constitutiveCache<dim> lastUpdate;
+    /**
+     * Largest change of an entry of F for which the results in lastUpdate are reused (negative: re-evaluate every point)
+     */
+    double reevaluationTolerance;
     /**
      * global volume
      */
@@ -206,37 +308,41 @@ private:
     /**
      * Stores original crystal orientations as rodrigues vectors by element number and quadratureID
      */
-    std::vector<std::vector<  Vector<double> > >  rot;
+    quadratureHistory rot;
     /**
      * Stores deformed crystal orientations as rodrigues vectors by element number and quadratureID
      */
-    std::vector<std::vector<  Vector<double> > >  rotnew;
+    quadratureHistory rotnew;
+    /**
+     * Rotation matrices of the original crystal orientations (rot) by element number and quadratureID
+     */
+    quadratureHistory rotationMatrix;
     
     //Store history variables
     /**
      * Stores Plastic deformation gradient by element number and quadratureID at each iteration
      */
-    std::vector< std::vector< FullMatrix<double> > >   Fp_iter;
+    quadratureHistory Fp_iter;
     /**
      * Stores Plastic deformation gradient by element number and quadratureID at each increment
      */
-    std::vector< std::vector< FullMatrix<double> > > Fp_conv;
+    quadratureHistory Fp_conv;
     /**
      * Stores Elastic deformation gradient by element number and quadratureID at each iteration
      */
-    std::vector< std::vector< FullMatrix<double> > >   Fe_iter;
+    quadratureHistory Fe_iter;
     /**
      * Stores Elastic deformation gradient by element number and quadratureID at each increment
      */
-    std::vector< std::vector< FullMatrix<double> > > Fe_conv;
+    quadratureHistory Fe_conv;
     /**
      * Stores slip resistance by element number and quadratureID at each iteration
      */
-    std::vector<std::vector<  Vector<double> > >  s_alpha_iter;
+    quadratureHistory s_alpha_iter;
     /**
      * Stores slip resistance by element number and quadratureID at each increment
      */
-    std::vector<std::vector<  Vector<double> > >  s_alpha_conv;
+    quadratureHistory s_alpha_conv;
     
     /**
      * No. of slip systems
@@ -261,9 +367,13 @@ private:
      */
     FullMatrix<double> Dmat;
     /**
-     * slip resistance
+     * Schmid tensors of the slip systems, stacked row-wise (dim*n_slip_systems x dim)
+     */
+    FullMatrix<double> SCHMID_TENSOR1;
+    /**
+     * Elastic Stiffness Matrix acting on the row-wise components of a second order tensor (dim*dim x dim*dim)
      */
-    Vector<double> sres_tau;
+    FullMatrix<double> TM;
     bool initCalled;
     
     //orientatations data for each quadrature point
@@ -278,6 +388,7 @@ private:
 //header files till library packaging scheme is finalized)
 #include "model.cc"
 #include "calculatePlasticity.cc"
+#include "calculatePlasticityBatch.cc"
 #include "rotationOperations.cc"
 #include "init.cc"
 #include "matrixOperations.cc"
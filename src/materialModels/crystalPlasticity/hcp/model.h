@@ -5,6 +5,11 @@
 //dealii headers
 #include "../../../../include/ellipticBVP.h"
 #include "../../../../src/utilityObjects/crystalOrientationsIO.cc"
+#include "../../../../src/utilityObjects/quadratureHistory.cc"
+#include "../../../../src/utilityObjects/activeSetSolver.cc"
+#include "../../../../src/utilityObjects/elementalStiffness.cc"
+#include "../../../../src/utilityObjects/constitutiveBatch.cc"
+#include "../../../../src/utilityObjects/constitutiveCache.cc"
 #include <iostream>
 #include <fstream>
 
@@ -26,16 +31,24 @@ public:
 #endif 
     void reorient();
     void tangent_modulus(FullMatrix<double> &F_trial, FullMatrix<double> &Fpn_inv, FullMatrix<double> &SCHMID_TENSOR1, FullMatrix<double> &A,FullMatrix<double> &A_PA,FullMatrix<double> &B,FullMatrix<double> &T_tau, FullMatrix<double> &PK1_Stiff, Vector<double> &active, Vector<double> &resolved_shear_tau_trial, Vector<double> &x_beta, Vector<double> &PA, int &n_PA, double &det_F_tau, double &det_FE_tau );
-    void inactive_slip_removal(Vector<double> &active,Vector<double> &x_beta_old, Vector<double> &x_beta, int &n_PA, Vector<double> &PA, Vector<double> b,FullMatrix<double> A,FullMatrix<double> &A_PA);
+    void inactive_slip_removal(Vector<double> &active,Vector<double> &x_beta_old, Vector<double> &x_beta, int &n_PA, Vector<double> &PA, const Vector<double> &b,const FullMatrix<double> &A,FullMatrix<double> &A_PA,activeSetSolver &slipSolver);
+    //batched constitutive update of the quadrature points of batch, which may span several cells
+    //(F in, P, T and the compact dP_dF out, see constitutiveBatch). The history of the block is
+    //gathered into batch before and scattered from batch after the update.
+    //Returns the number of points that took the elastic fast path, and in numReused the number of
+    //points whose stored results were reused (selective re-evaluation, see lastUpdate)
+    unsigned int calculatePlasticityBatch(constitutiveBatch<dim> &batch, unsigned int &numReused);
     //material properties
     materialProperties properties;
     //orientation maps
     crystalOrientationsIO<dim> orientations;
 private:
+    struct quadPointData;
     void init(unsigned int num_quad_points);
     void setBoundaryValues(const Point<dim>& node, const unsigned int dof, bool& flag, double& value); 
-    void calculatePlasticity(unsigned int cellID,
-                             unsigned int quadPtID);
+    void calculatePlasticity(constitutiveBatch<dim> &batch,
+                             unsigned int p,
+                             quadPointData &qpData);
     void getElementalValues(FEValues<dim>& fe_values,
                             unsigned int dofs_per_cell,
                             unsigned int num_quad_points,
@@ -43,12 +56,22 @@ private:
                             Vector<double>&     elementalResidual);
     void updateAfterIncrement();
     void updateBeforeIteration();
+    void updateAfterAssembly();
     void updateBeforeIncrement();
+    void writeCheckpointData(std::ostream& out);
+    void readCheckpointData(std::istream& in);
+    unsigned int historyDataSize();
+    void packHistoryData(const unsigned int cellID, const unsigned int q, double* data);
+    void reinitHistoryData(const unsigned int numLocalCells);
+    void unpackHistoryData(const unsigned int cellID, const unsigned int q, const double* data);
+    void updateAfterMeshChange();
     
     
-    void odfpoint(FullMatrix <double> &OrientationMatrix,Vector<double> r);
-    Vector<double> vecform(FullMatrix<double> A);
-    void matform(FullMatrix<double> &A, Vector<double> Av);
+    void odfpoint(FullMatrix <double> &OrientationMatrix,const Vector<double> &r);
+    void updateRotationMatrix(unsigned int cellID, unsigned int quadPtID);
+    Vector<double> vecform(const FullMatrix<double> &A);
+    void vecform(const FullMatrix<double> &A, Vector<double> &Av);
+    void matform(FullMatrix<double> &A, const Vector<double> &Av);
     void right(FullMatrix<double> &Aright,FullMatrix<double> elm);
     void symmf(FullMatrix<double> &A,FullMatrix<double> elm);
     void left(FullMatrix<double> &Aleft,FullMatrix<double> elm);
@@ -59,36 +82,75 @@ private:
     void quatproduct(Vector<double> &quatp,Vector<double> &quat2,Vector<double> &quat1);
     void quat2rod(Vector<double> &quat,Vector<double> &rod);
     /**
-     *calculates the matrix exponential of matrix A
+     *calculates the matrix exponential of the 3x3 matrix A (written into expA)
      */
     
-    FullMatrix<double> matrixExponential(FullMatrix<double> A);
+    void matrixExponential(const FullMatrix<double> &A, FullMatrix<double> &expA);
     
     
     
     
-    FullMatrix<double> F,F_tau,FP_tau,FE_tau,T,P,local_stress,local_strain,global_stress,global_strain;
-    Tensor<4,dim,double> dP_dF;
+    //work arrays of calculatePlasticity, kept per thread in quadPointData. They are only
+    //resized from one quadrature point to the next, so that the constitutive update does
+    //not allocate heap memory once the arrays have reached their final size
+    struct plasticityWorkspace{
+        FullMatrix<double> FE_t,FP_t,rotmat,temp,temp1,temp2,temp3,temp4,temp5,temp6,CE_exp_FP;
+        FullMatrix<double> T_tau,P_tau,Fpn_inv,FE_tau_trial,F_trial,CE_tau_trial,FP_t2,Ee_tau_trial;
+        FullMatrix<double> h_alpha_beta_t,A,del_FP,A_PA,PK1_Stiff,delFp_delF,delFp_delF2,delFp_delF_prev;
+        FullMatrix<double> dels_delF,dels_delF_prev,A2,delFe_delF,delEtrial_delF,deltau_delF,delT_delF,delb_delF,delgamma_delF,S_PA;
+        FullMatrix<double> A_ds,delgamma_delF2,delTstar_delF,Ce_tau,T_star_tau,T_star_tau_trial,diff_FP,term_ds,PK_Stiff5,L;
+        FullMatrix<double> LL,PK_Stiff_LL,elasticM,elasticN,temp7;
+        Vector<double> s_alpha_t,s_alpha_tau,s_beta,h_beta,delh_beta_dels;
+        Vector<double> h0,a_pow,s_s,active,PA,PA_temp,resolved_shear_tau_trial,b,resolved_shear_tau,x_beta_old;
+        Vector<double> x_beta,tempv1,tempv2,b_PA,tempv3;
+        activeSetSolver slipSolver;
+    };
+    //quadrature point data exchanged between getElementalValues and calculatePlasticity,
+    //kept per thread so that cells can be assembled concurrently
+    struct quadPointData{
+        quadPointData(): F(dim,dim), F_tau(dim,dim), FP_tau(dim,dim), FE_tau(dim,dim), T(dim,dim), P(dim,dim), dP_dF(dim*dim,dim*dim), elastic(false),
+            CE_tau(dim,dim), E_tau(dim,dim), deve(dim,dim), devt(dim,dim) {}
+        FullMatrix<double> F,F_tau,FP_tau,FE_tau,T,P;
+        FullMatrix<double> dP_dF; //compact tangent, dP_dF(dim*i+k,dim*j+l)=dP_ik/dF_jl
+        bool elastic; //true if the last update took the elastic fast path (no active slip system)
+        FullMatrix<double> CE_tau,E_tau,deve,devt; //strain and deviators of the post-processed fields (getElementalValues)
+        Vector<double> sres_tau;
+        plasticityWorkspace work;
+        elementalStiffness<dim> stiffness;
+        constitutiveBatch<dim> batch;
+    };
+    Threads::ThreadLocalStorage<quadPointData> quadPointScratch;
+    FullMatrix<double> local_stress,local_strain,global_stress,global_strain;
     double No_Elem, N_qpts,local_F_e,local_F_r,F_e,F_r,local_microvol,microvol;
+    //quadrature points per core that took the elastic fast path or the slip system search in the current assembly
+    unsigned int local_elasticQuadPoints,local_plasticQuadPoints;
+    //quadrature points per core whose stored constitutive update was reused in the current assembly
+    unsigned int local_reusedQuadPoints;
+    //results of the last constitutive update of each quadrature point, reused while no entry of F
+    //changed by more than reevaluationTolerance (negative: re-evaluate every point)
+    constitutiveCache<dim> lastUpdate;
+    double reevaluationTolerance;
     double signstress;
     
     //Store crystal orientations
-    std::vector<std::vector<  Vector<double> > >  rot;
-    std::vector<std::vector<  Vector<double> > >  rotnew;
+    quadratureHistory rot;
+    quadratureHistory rotnew;
+    quadratureHistory rotationMatrix; //rotation matrices of rot
     
     //Store history variables
-    std::vector< std::vector< FullMatrix<double> > >   Fp_iter;
-    std::vector< std::vector< FullMatrix<double> > > Fp_conv;
-    std::vector< std::vector< FullMatrix<double> > >   Fe_iter;
-    std::vector< std::vector< FullMatrix<double> > > Fe_conv;
-    std::vector<std::vector<  Vector<double> > >  s_alpha_iter;
-    std::vector<std::vector<  Vector<double> > >  s_alpha_conv;
+    quadratureHistory Fp_iter;
+    quadratureHistory Fp_conv;
+    quadratureHistory Fe_iter;
+    quadratureHistory Fe_conv;
+    quadratureHistory s_alpha_iter;
+    quadratureHistory s_alpha_conv;
     std::vector<std::vector<  vector<double> > >  twinfraction_iter, slipfraction_iter,twinfraction_conv, slipfraction_conv;
     std::vector<std::vector<double> >  twin;
     
     unsigned int n_slip_systems,n_twin_systems; //No. of slip systems
     FullMatrix<double> m_alpha,n_alpha,q,sres,Dmat;
-    Vector<double> sres_tau;
+    //Schmid tensors (stacked row-wise) and elastic stiffness in tensor component form
+    FullMatrix<double> SCHMID_TENSOR1,TM;
     bool initCalled;
     
     //orientatations data for each quadrature point
@@ -100,6 +162,7 @@ private:
 //header files till library packaging scheme is finalized)
 #include "model.cc"
 #include "calculatePlasticity.cc"
+#include "calculatePlasticityBatch.cc"
 #include "rotationOperations.cc"
 #include "init.cc"
 #include "matrixOperations.cc"
@@ -0,0 +1,208 @@
+//small dense solver for the slip increments of the active slip systems
+
+#ifndef ACTIVESETSOLVER_H
+#define ACTIVESETSOLVER_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//Solves A x=b for the (non-symmetric) consistency matrix of the active slip
+//systems. A is factorized by LU with partial pivoting. If a pivot falls below
+//the rank tolerance (linearly dependent slip systems, e.g. more than five
+//active systems in FCC) the factorization falls back to a complete orthogonal
+//decomposition: Householder QR with column pivoting, A P=Q [R11 R12; 0 0],
+//followed by a QR of [R11 R12]^T=Z [T; 0]. x=P Z [T^-T c; 0], with c the
+//leading numericalRank entries of Q^T b, is the minimum-norm least-squares
+//solution, the same as with the pseudo-inverse of A. The work arrays are only resized, so a solver kept per thread does
+//not allocate heap memory once it has seen the largest active set.
+class activeSetSolver
+{
+ public:
+  activeSetSolver(): n(0), numericalRank(0), useQR(false) {}
+
+  //factorize the square matrix A
+  void factorize(const FullMatrix<double>& A){
+    AssertDimension(A.m(), A.n());
+    n=A.m(); numericalRank=n; useQR=false;
+    a.resize(n*n); perm.resize(n); v.resize(n);
+    double maxEntry=0.0;
+    for (unsigned int i=0; i<n; i++){
+      for (unsigned int j=0; j<n; j++){
+	a[i*n+j]=A(i,j);
+	maxEntry=std::max(maxEntry, std::abs(A(i,j)));
+      }
+    }
+    const double tol=rankTolerance*maxEntry;
+
+    //LU with partial pivoting, a=L\U with unit diagonal L
+    for (unsigned int i=0; i<n; i++) perm[i]=i;
+    for (unsigned int k=0; k<n; k++){
+      unsigned int p=k;
+      for (unsigned int i=k+1; i<n; i++){
+	if (std::abs(a[i*n+k])>std::abs(a[p*n+k])) p=i;
+      }
+      if (std::abs(a[p*n+k])<=tol){
+	factorizeQR(A);
+	return;
+      }
+      if (p!=k){
+	for (unsigned int j=0; j<n; j++) std::swap(a[k*n+j], a[p*n+j]);
+	std::swap(perm[k], perm[p]);
+      }
+      for (unsigned int i=k+1; i<n; i++){
+	const double l=(a[i*n+k]/=a[k*n+k]);
+	for (unsigned int j=k+1; j<n; j++) a[i*n+j]-=l*a[k*n+j];
+      }
+    }
+  }
+
+  //solve A x=b with the last factorization
+  void solve(const Vector<double>& b, Vector<double>& x){
+    AssertDimension(b.size(), n);
+    x.reinit(n);
+    if (!useQR){
+      //forward and back substitution with the row permutation
+      for (unsigned int i=0; i<n; i++){
+	double sum=b(perm[i]);
+	for (unsigned int j=0; j<i; j++) sum-=a[i*n+j]*v[j];
+	v[i]=sum;
+      }
+      for (int i=(int)n-1; i>=0; i--){
+	double sum=v[i];
+	for (unsigned int j=i+1; j<n; j++) sum-=a[i*n+j]*v[j];
+	v[i]=sum/a[i*n+i];
+      }
+      for (unsigned int i=0; i<n; i++) x(i)=v[i];
+    }
+    else{
+      //c=Q^T b on the leading numericalRank rows
+      const unsigned int r=numericalRank;
+      for (unsigned int i=0; i<n; i++) v[i]=b(i);
+      for (unsigned int k=0; k<r; k++){
+	double s=0.0;
+	for (unsigned int i=k; i<n; i++) s+=a[i*n+k]*v[i];
+	s*=2.0/tau[k];
+	for (unsigned int i=k; i<n; i++) v[i]-=s*a[i*n+k];
+      }
+      if (r==n){
+	//full rank: R z=c
+	for (int i=(int)n-1; i>=0; i--){
+	  double sum=v[i];
+	  for (unsigned int j=i+1; j<n; j++) sum-=a[i*n+j]*v[j];
+	  v[i]=sum/rDiag[i];
+	}
+      }
+      else{
+	//T^T w=c, then z=Z [w; 0]
+	for (unsigned int i=0; i<r; i++){
+	  double sum=v[i];
+	  for (unsigned int j=0; j<i; j++) sum-=t[j*r+i]*v[j];
+	  v[i]=sum/tDiag[i];
+	}
+	for (unsigned int i=r; i<n; i++) v[i]=0.0;
+	for (int k=(int)r-1; k>=0; k--){
+	  double s=0.0;
+	  for (unsigned int i=k; i<n; i++) s+=t[i*r+k]*v[i];
+	  s*=2.0/tau2[k];
+	  for (unsigned int i=k; i<n; i++) v[i]-=s*t[i*r+k];
+	}
+      }
+      for (unsigned int i=0; i<n; i++) x(perm[i])=v[i];
+    }
+  }
+
+  unsigned int rank() const {return numericalRank;}
+  bool rankDeficient() const {return numericalRank<n;}
+
+ private:
+  //Householder QR with column pivoting. The Householder vectors are stored
+  //in the lower part of a (including the diagonal), R above the diagonal and in rDiag
+  void factorizeQR(const FullMatrix<double>& A){
+    useQR=true;
+    tau.resize(n); rDiag.resize(n); colNorm.resize(n);
+    for (unsigned int i=0; i<n; i++){
+      for (unsigned int j=0; j<n; j++) a[i*n+j]=A(i,j);
+    }
+    for (unsigned int j=0; j<n; j++){
+      perm[j]=j; colNorm[j]=0.0;
+      for (unsigned int i=0; i<n; i++) colNorm[j]+=a[i*n+j]*a[i*n+j];
+    }
+    double firstDiag=0.0;
+    numericalRank=n;
+    for (unsigned int k=0; k<n; k++){
+      unsigned int p=k;
+      for (unsigned int j=k+1; j<n; j++){
+	if (colNorm[j]>colNorm[p]) p=j;
+      }
+      if (p!=k){
+	for (unsigned int i=0; i<n; i++) std::swap(a[i*n+k], a[i*n+p]);
+	std::swap(colNorm[k], colNorm[p]);
+	std::swap(perm[k], perm[p]);
+      }
+      double alpha=0.0;
+      for (unsigned int i=k; i<n; i++) alpha+=a[i*n+k]*a[i*n+k];
+      alpha=std::sqrt(alpha);
+      if (k==0) firstDiag=alpha;
+      if (alpha<=rankTolerance*firstDiag){
+	numericalRank=k;
+	factorizeTrapezoid();
+	return;
+      }
+      if (a[k*n+k]>0.0) alpha=-alpha;
+      a[k*n+k]-=alpha;
+      tau[k]=0.0;
+      for (unsigned int i=k; i<n; i++) tau[k]+=a[i*n+k]*a[i*n+k];
+      rDiag[k]=alpha;
+      for (unsigned int j=k+1; j<n; j++){
+	double s=0.0;
+	for (unsigned int i=k; i<n; i++) s+=a[i*n+k]*a[i*n+j];
+	s*=2.0/tau[k];
+	for (unsigned int i=k; i<n; i++) a[i*n+j]-=s*a[i*n+k];
+	colNorm[j]=0.0;
+	for (unsigned int i=k+1; i<n; i++) colNorm[j]+=a[i*n+j]*a[i*n+j];
+      }
+    }
+  }
+
+  //Householder QR of the n x numericalRank matrix [R11 R12]^T=Z [T; 0]. The
+  //Householder vectors are stored in the lower part of t (row-major, numericalRank
+  //columns, including the diagonal), T above the diagonal and in tDiag
+  void factorizeTrapezoid(){
+    const unsigned int r=numericalRank;
+    if (r==0) return;
+    t.resize(n*r); tau2.resize(r); tDiag.resize(r);
+    for (unsigned int i=0; i<n; i++){
+      for (unsigned int j=0; j<r; j++){
+	//entry (i,j) of [R11 R12]^T is R(j,i)
+	t[i*r+j]=(i<j) ? 0.0 : ((i==j) ? rDiag[j] : a[j*n+i]);
+      }
+    }
+    for (unsigned int k=0; k<r; k++){
+      double alpha=0.0;
+      for (unsigned int i=k; i<n; i++) alpha+=t[i*r+k]*t[i*r+k];
+      alpha=std::sqrt(alpha);
+      if (t[k*r+k]>0.0) alpha=-alpha;
+      t[k*r+k]-=alpha;
+      tau2[k]=0.0;
+      for (unsigned int i=k; i<n; i++) tau2[k]+=t[i*r+k]*t[i*r+k];
+      tDiag[k]=alpha;
+      for (unsigned int j=k+1; j<r; j++){
+	double s=0.0;
+	for (unsigned int i=k; i<n; i++) s+=t[i*r+k]*t[i*r+j];
+	s*=2.0/tau2[k];
+	for (unsigned int i=k; i<n; i++) t[i*r+j]-=s*t[i*r+k];
+      }
+    }
+  }
+
+  static const double rankTolerance;
+  unsigned int n, numericalRank;
+  bool useQR;
+  std::vector<double> a, v, tau, rDiag, colNorm, t, tau2, tDiag;
+  std::vector<unsigned int> perm;
+};
+
+//pivots below rankTolerance times the largest entry (LU) or the first
+//diagonal entry of R (QR) are treated as zero
+const double activeSetSolver::rankTolerance=1.0e-12;
+
+#endif
@@ -0,0 +1,173 @@
+//process-local staging area for the global jacobian and residual
+
+#ifndef ASSEMBLYBUFFER_H
+#define ASSEMBLYBUFFER_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//The PETSc matrix and vector wrappers are not thread-safe, not even for
+//writes into different rows. This buffer stores the locally relevant rows of
+//the jacobian (with the column structure of the global sparsity pattern) and
+//of the residual in global dof numbering, so that ConstraintMatrix can
+//scatter into it concurrently from several threads as long as the threads
+//write into different rows. The staged values are then added to the PETSc
+//objects in a single serial pass.
+
+//ConstraintMatrix::distribute_local_to_global is only instantiated by deal.II
+//for its own matrix and vector types, the buffer types need the template definitions
+#include <deal.II/lac/constraint_matrix.templates.h>
+
+//matrix part of the buffer
+class assemblyBufferMatrix
+{
+ public:
+  typedef types::global_dof_index size_type;
+  typedef double value_type;
+  assemblyBufferMatrix(): n_global(0) {}
+  virtual ~assemblyBufferMatrix() {}
+
+  void reinit(const IndexSet& rowSet, const CompressedSimpleSparsityPattern& csp){
+    rows=rowSet; rows.compress();
+    n_global=csp.n_rows();
+    rowStart.resize(rows.n_elements()+1);
+    rowStart[0]=0;
+    for (size_type i=0; i<rows.n_elements(); i++){
+      rowStart[i+1]=rowStart[i]+csp.row_length(rows.nth_index_in_set(i));
+    }
+    colIndices.resize(rowStart[rows.n_elements()]);
+    for (size_type i=0; i<rows.n_elements(); i++){
+      const size_type row=rows.nth_index_in_set(i);
+      for (size_type j=0; j<csp.row_length(row); j++){
+	colIndices[rowStart[i]+j]=csp.column_number(row, j);
+      }
+    }
+    values.resize(colIndices.size());
+    std::fill(values.begin(), values.end(), 0.0);
+  }
+  size_type m() const {return n_global;}
+  size_type n() const {return n_global;}
+  bool empty() const {return values.empty();}
+  void zero() {std::fill(values.begin(), values.end(), 0.0);}
+
+  //interface used by ConstraintMatrix::distribute_local_to_global
+  void add(const size_type row, const size_type col, const double value){
+    const size_type i=rows.index_within_set(row);
+    std::vector<size_type>::const_iterator begin=colIndices.begin()+rowStart[i], end=colIndices.begin()+rowStart[i+1];
+    std::vector<size_type>::const_iterator p=std::lower_bound(begin, end, col);
+    Assert((p!=end) && (*p==col), ExcMessage("entry not in the sparsity pattern of the assembly buffer"));
+    values[p-colIndices.begin()]+=value;
+  }
+  //the row is looked up once, sorted columns are matched by a merge walk along the row
+  void add(const size_type row, const size_type n_cols, const size_type* col_indices, const double* vals, const bool elide_zero_values=true, const bool col_indices_are_sorted=false){
+    const size_type i=rows.index_within_set(row);
+    std::vector<size_type>::const_iterator begin=colIndices.begin()+rowStart[i], end=colIndices.begin()+rowStart[i+1];
+    std::vector<size_type>::const_iterator p=begin;
+    for (size_type j=0; j<n_cols; j++){
+      if (elide_zero_values && vals[j]==0.0) continue;
+      if (col_indices_are_sorted){
+	while ((p!=end) && (*p<col_indices[j])) ++p;
+      }
+      else p=std::lower_bound(begin, end, col_indices[j]);
+      Assert((p!=end) && (*p==col_indices[j]), ExcMessage("entry not in the sparsity pattern of the assembly buffer"));
+      values[p-colIndices.begin()]+=vals[j];
+    }
+  }
+
+  //values+=other.values (both buffers must have the same structure)
+  void add(const assemblyBufferMatrix& other){
+    AssertDimension(values.size(), other.values.size());
+    for (size_type k=0; k<values.size(); k++){
+      values[k]+=other.values[k];
+    }
+  }
+
+  //add the staged rows to a PETSc matrix
+  template <typename MatrixType>
+  void addTo(MatrixType& A) const{
+    for (size_type i=0; i<rows.n_elements(); i++){
+      const size_type nCols=rowStart[i+1]-rowStart[i];
+      if (nCols==0) continue;
+      A.add(rows.nth_index_in_set(i), nCols, &colIndices[rowStart[i]], &values[rowStart[i]], true, true);
+    }
+  }
+
+ private:
+  IndexSet rows;
+  size_type n_global;
+  std::vector<size_type> rowStart, colIndices;
+  std::vector<double> values;
+};
+
+//vector part of the buffer
+class assemblyBufferVector
+{
+ public:
+  typedef types::global_dof_index size_type;
+  typedef double value_type;
+  assemblyBufferVector(): n_global(0) {}
+  virtual ~assemblyBufferVector() {}
+
+  void reinit(const IndexSet& rowSet){
+    rows=rowSet; rows.compress();
+    n_global=rows.size();
+    values.resize(rows.n_elements());
+    std::fill(values.begin(), values.end(), 0.0);
+  }
+  size_type size() const {return n_global;}
+  void zero() {std::fill(values.begin(), values.end(), 0.0);}
+
+  //interface used by ConstraintMatrix::distribute_local_to_global
+  double& operator()(const size_type i) {return values[rows.index_within_set(i)];}
+  double operator()(const size_type i) const {return values[rows.index_within_set(i)];}
+
+  void add(const assemblyBufferVector& other){
+    AssertDimension(values.size(), other.values.size());
+    for (size_type k=0; k<values.size(); k++){
+      values[k]+=other.values[k];
+    }
+  }
+
+  //add the staged entries to a PETSc vector
+  template <typename VectorType>
+  void addTo(VectorType& b) const{
+    std::vector<size_type> indices;
+    std::vector<double> vals;
+    for (size_type i=0; i<values.size(); i++){
+      if (values[i]==0.0) continue;
+      indices.push_back(rows.nth_index_in_set(i));
+      vals.push_back(values[i]);
+    }
+    b.add(indices, vals);
+  }
+
+ private:
+  IndexSet rows;
+  size_type n_global;
+  std::vector<double> values;
+};
+
+//jacobian and residual buffers
+struct assemblyBuffer
+{
+  void reinit(const IndexSet& rowSet, const CompressedSimpleSparsityPattern& csp){
+    jacobian.reinit(rowSet, csp);
+    residual.reinit(rowSet);
+  }
+  void zero(){
+    jacobian.zero();
+    residual.zero();
+  }
+  void add(const assemblyBuffer& other){
+    jacobian.add(other.jacobian);
+    residual.add(other.residual);
+  }
+  template <typename MatrixType, typename VectorType>
+  void addTo(MatrixType& A, VectorType& b) const{
+    jacobian.addTo(A);
+    residual.addTo(b);
+  }
+  assemblyBufferMatrix jacobian;
+  assemblyBufferVector residual;
+};
+
+#endif
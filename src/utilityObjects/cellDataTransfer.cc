@@ -0,0 +1,67 @@
+//packing of cell and quadrature point data into a buffer of doubles
+
+#ifndef CELLDATATRANSFER_H
+#define CELLDATATRANSFER_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//Cells moved to another processor or refined/coarsened carry their history as a
+//fixed number of doubles per cell and quadrature point (see
+//ellipticBVP<dim>::updateMesh). The overloads copy the values to the buffer and
+//back, and return the position behind the copied values. Containers are not resized on unpacking, they have to be
+//allocated with the sizes they had when they were packed.
+
+inline double* packCellData(const double value, double* buffer){
+  *buffer=value;
+  return buffer+1;
+}
+inline const double* unpackCellData(double& value, const double* buffer){
+  value=*buffer;
+  return buffer+1;
+}
+
+//integers (e.g. grain ids) are exactly representable as doubles
+inline double* packCellData(const unsigned int value, double* buffer){
+  *buffer=value;
+  return buffer+1;
+}
+inline const double* unpackCellData(unsigned int& value, const double* buffer){
+  value=(unsigned int) *buffer;
+  return buffer+1;
+}
+
+inline double* packCellData(const Vector<double>& v, double* buffer){
+  std::copy(v.begin(), v.end(), buffer);
+  return buffer+v.size();
+}
+inline const double* unpackCellData(Vector<double>& v, const double* buffer){
+  std::copy(buffer, buffer+v.size(), v.begin());
+  return buffer+v.size();
+}
+
+inline double* packCellData(const FullMatrix<double>& A, double* buffer){
+  for (unsigned int i=0; i<A.m(); i++){
+    for (unsigned int j=0; j<A.n(); j++) *buffer++=A(i,j);
+  }
+  return buffer;
+}
+inline const double* unpackCellData(FullMatrix<double>& A, const double* buffer){
+  for (unsigned int i=0; i<A.m(); i++){
+    for (unsigned int j=0; j<A.n(); j++) A(i,j)=*buffer++;
+  }
+  return buffer;
+}
+
+//(nested) std::vector, the elements are packed with the overloads above
+template <typename T>
+double* packCellData(const std::vector<T>& v, double* buffer){
+  for (unsigned int i=0; i<v.size(); i++) buffer=packCellData(v[i], buffer);
+  return buffer;
+}
+template <typename T>
+const double* unpackCellData(std::vector<T>& v, const double* buffer){
+  for (unsigned int i=0; i<v.size(); i++) buffer=unpackCellData(v[i], buffer);
+  return buffer;
+}
+
+#endif
@@ -0,0 +1,79 @@
+//binary input and output of the checkpoint data
+
+#ifndef CHECKPOINTIO_H
+#define CHECKPOINTIO_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//Values are written in their native binary representation, so a checkpoint is
+//read back on the same kind of machine. Containers are preceded by their size.
+//Reading checks the size against the container, which has already been
+//allocated for the current mesh, so the data of a different mesh or partition
+//is rejected instead of being read out of place.
+
+//format version of the checkpoint files
+const unsigned int checkpointFormatVersion=4;
+
+template <typename T>
+void checkpointWrite(std::ostream& out, const T& value){
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+template <typename T>
+void checkpointRead(std::istream& in, T& value){
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+//size of a container, checked on reading
+inline void checkpointReadSize(std::istream& in, const std::size_t expectedSize){
+  std::size_t n=0;
+  checkpointRead(in, n);
+  AssertThrow(in && (n==expectedSize), ExcMessage("checkpoint data does not match the current mesh and partition"));
+}
+
+inline void checkpointWrite(std::ostream& out, const Vector<double>& v){
+  checkpointWrite(out, (std::size_t) v.size());
+  out.write(reinterpret_cast<const char*>(v.begin()), v.size()*sizeof(double));
+}
+inline void checkpointRead(std::istream& in, Vector<double>& v){
+  checkpointReadSize(in, v.size());
+  in.read(reinterpret_cast<char*>(v.begin()), v.size()*sizeof(double));
+}
+
+inline void checkpointWrite(std::ostream& out, const FullMatrix<double>& A){
+  checkpointWrite(out, (std::size_t) A.n_elements());
+  for (unsigned int i=0; i<A.m(); i++){
+    for (unsigned int j=0; j<A.n(); j++) checkpointWrite(out, A(i,j));
+  }
+}
+inline void checkpointRead(std::istream& in, FullMatrix<double>& A){
+  checkpointReadSize(in, A.n_elements());
+  for (unsigned int i=0; i<A.m(); i++){
+    for (unsigned int j=0; j<A.n(); j++) checkpointRead(in, A(i,j));
+  }
+}
+
+inline void checkpointWrite(std::ostream& out, const std::string& s){
+  checkpointWrite(out, (std::size_t) s.size());
+  out.write(s.data(), s.size());
+}
+inline void checkpointRead(std::istream& in, std::string& s){
+  std::size_t n=0;
+  checkpointRead(in, n);
+  if (!in) return;
+  s.resize(n);
+  if (n>0) in.read(&s[0], n);
+}
+
+//(nested) std::vector, the elements are written with the overloads above
+template <typename T>
+void checkpointWrite(std::ostream& out, const std::vector<T>& v){
+  checkpointWrite(out, (std::size_t) v.size());
+  for (unsigned int i=0; i<v.size(); i++) checkpointWrite(out, v[i]);
+}
+template <typename T>
+void checkpointRead(std::istream& in, std::vector<T>& v){
+  checkpointReadSize(in, v.size());
+  for (unsigned int i=0; i<v.size(); i++) checkpointRead(in, v[i]);
+}
+
+#endif
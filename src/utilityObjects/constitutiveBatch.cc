@@ -0,0 +1,119 @@
+//input and output of a batched constitutive update
+
+#ifndef CONSTITUTIVEBATCH_H
+#define CONSTITUTIVEBATCH_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//Holds a block of quadrature points handed to a batched constitutive update:
+//the cell and quadrature point of every point (a block may span several
+//cells), the deformation gradients F (input), and the first Piola-Kirchhoff
+//stresses P, the Cauchy stresses T and the compact tangents dP/dF (output).
+//The material model gathers the history of the points into historyIn once per
+//block and scatters the updated history from historyOut, historyInSize and
+//historyOutSize values per point in a layout of its choice. Per point, F, P
+//and T are stored row-wise (dim*dim entries) and dP/dF in the compact layout
+//(dim*dim)x(dim*dim), row dim*i+k and column dim*j+l, all point-major so a
+//block can be streamed through contiguously. The arrays are only resized, so a
+//batch kept per thread does not allocate heap memory once it has seen the
+//largest block.
+template <int dim>
+class constitutiveBatch
+{
+ public:
+  constitutiveBatch(): numQuadPts(0), historyInSize(0), historyOutSize(0) {}
+
+  //resize for a block of n quadrature points
+  void reinit(const unsigned int n){
+    numQuadPts=n;
+    cellIDs.resize(n); quadPts.resize(n); updated.resize(n);
+    F.resize(n*dim*dim); P.resize(n*dim*dim); T.resize(n*dim*dim);
+    dP_dF.resize(n*dim*dim*dim*dim);
+    historyIn.resize(n*historyInSize); historyOut.resize(n*historyOutSize);
+  }
+  //set the number of history values per point gathered before and scattered after the update
+  void reinitHistory(const unsigned int _historyInSize, const unsigned int _historyOutSize){
+    historyInSize=_historyInSize; historyOutSize=_historyOutSize;
+    historyIn.resize(numQuadPts*historyInSize); historyOut.resize(numQuadPts*historyOutSize);
+  }
+
+  unsigned int size() const {return numQuadPts;}
+
+  //cell and quadrature point of the point p
+  void setPoint(const unsigned int p, const unsigned int cellID, const unsigned int q){
+    AssertIndexRange(p, numQuadPts);
+    cellIDs[p]=cellID; quadPts[p]=q;
+  }
+  unsigned int cellID(const unsigned int p) const {AssertIndexRange(p, numQuadPts); return cellIDs[p];}
+  unsigned int quadPt(const unsigned int p) const {AssertIndexRange(p, numQuadPts); return quadPts[p];}
+
+  //points updated by the constitutive model (false: stored results reused, history not scattered)
+  void setUpdated(const unsigned int p, const bool isUpdated) {AssertIndexRange(p, numQuadPts); updated[p]=isUpdated;}
+  bool isUpdated(const unsigned int p) const {AssertIndexRange(p, numQuadPts); return updated[p];}
+
+  //history of the point p before (in) and after (out) the update
+  double* historyIn_ptr(const unsigned int p) {AssertIndexRange(p, numQuadPts); return &historyIn[p*historyInSize];}
+  const double* historyIn_ptr(const unsigned int p) const {AssertIndexRange(p, numQuadPts); return &historyIn[p*historyInSize];}
+  double* historyOut_ptr(const unsigned int p) {AssertIndexRange(p, numQuadPts); return &historyOut[p*historyOutSize];}
+  const double* historyOut_ptr(const unsigned int p) const {AssertIndexRange(p, numQuadPts); return &historyOut[p*historyOutSize];}
+
+  //pointers to the entries of the point p
+  double* F_ptr(const unsigned int p) {AssertIndexRange(p, numQuadPts); return &F[p*dim*dim];}
+  const double* F_ptr(const unsigned int p) const {AssertIndexRange(p, numQuadPts); return &F[p*dim*dim];}
+  double* P_ptr(const unsigned int p) {AssertIndexRange(p, numQuadPts); return &P[p*dim*dim];}
+  const double* P_ptr(const unsigned int p) const {AssertIndexRange(p, numQuadPts); return &P[p*dim*dim];}
+  double* T_ptr(const unsigned int p) {AssertIndexRange(p, numQuadPts); return &T[p*dim*dim];}
+  const double* T_ptr(const unsigned int p) const {AssertIndexRange(p, numQuadPts); return &T[p*dim*dim];}
+  double* dP_dF_ptr(const unsigned int p) {AssertIndexRange(p, numQuadPts); return &dP_dF[p*dim*dim*dim*dim];}
+  const double* dP_dF_ptr(const unsigned int p) const {AssertIndexRange(p, numQuadPts); return &dP_dF[p*dim*dim*dim*dim];}
+
+  //copy F of the point p to a dim x dim matrix
+  void getF(const unsigned int p, FullMatrix<double>& F_p) const{
+    const double* entry=F_ptr(p);
+    for (unsigned int i=0; i<dim; ++i){
+      for (unsigned int j=0; j<dim; ++j) F_p(i,j)=entry[i*dim+j];
+    }
+  }
+  void setF(const unsigned int p, const FullMatrix<double>& F_p){
+    double* entry=F_ptr(p);
+    for (unsigned int i=0; i<dim; ++i){
+      for (unsigned int j=0; j<dim; ++j) entry[i*dim+j]=F_p(i,j);
+    }
+  }
+
+  //copy the results of the point p to/from matrices (dP_dF of size dim*dim x dim*dim)
+  void setResults(const unsigned int p, const FullMatrix<double>& P_p, const FullMatrix<double>& T_p, const FullMatrix<double>& dP_dF_p){
+    AssertIndexRange(p, numQuadPts);
+    for (unsigned int i=0; i<dim; ++i){
+      for (unsigned int j=0; j<dim; ++j){
+	P[p*dim*dim+i*dim+j]=P_p(i,j);
+	T[p*dim*dim+i*dim+j]=T_p(i,j);
+      }
+    }
+    double* entry=&dP_dF[p*dim*dim*dim*dim];
+    for (unsigned int ik=0; ik<dim*dim; ++ik){
+      for (unsigned int jl=0; jl<dim*dim; ++jl) entry[ik*dim*dim+jl]=dP_dF_p(ik,jl);
+    }
+  }
+  void getResults(const unsigned int p, FullMatrix<double>& P_p, FullMatrix<double>& T_p, FullMatrix<double>& dP_dF_p) const{
+    AssertIndexRange(p, numQuadPts);
+    for (unsigned int i=0; i<dim; ++i){
+      for (unsigned int j=0; j<dim; ++j){
+	P_p(i,j)=P[p*dim*dim+i*dim+j];
+	T_p(i,j)=T[p*dim*dim+i*dim+j];
+      }
+    }
+    const double* entry=&dP_dF[p*dim*dim*dim*dim];
+    for (unsigned int ik=0; ik<dim*dim; ++ik){
+      for (unsigned int jl=0; jl<dim*dim; ++jl) dP_dF_p(ik,jl)=entry[ik*dim*dim+jl];
+    }
+  }
+
+ private:
+  unsigned int numQuadPts, historyInSize, historyOutSize;
+  std::vector<unsigned int> cellIDs, quadPts;
+  std::vector<bool> updated;
+  std::vector<double> F, P, T, dP_dF, historyIn, historyOut;
+};
+
+#endif
@@ -0,0 +1,73 @@
+//results of the last constitutive update of every quadrature point
+
+#ifndef CONSTITUTIVECACHE_H
+#define CONSTITUTIVECACHE_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//Keeps the deformation gradient F, the stresses P and T, the compact tangent
+//dP/dF and the elastic flag of the last constitutive update of every quadrature
+//point of the locally owned cells, indexed by (cellID, quadrature point) like the
+//history variables. lookup hands the stored results of a point back if the point
+//was updated since the last invalidate() and no entry of F changed by more than
+//the tolerance since then. The entries of different cells are independent, so
+//cells can be handled concurrently.
+template <int dim>
+class constitutiveCache
+{
+ public:
+  //allocate the entries of numCells cells with numQuadPoints quadrature points each, all invalid
+  void reinit(const unsigned int numCells, const unsigned int numQuadPoints){
+    F.reinit(numCells, numQuadPoints, FullMatrix<double>(dim,dim));
+    P.reinit(numCells, numQuadPoints, FullMatrix<double>(dim,dim));
+    T.reinit(numCells, numQuadPoints, FullMatrix<double>(dim,dim));
+    dP_dF.reinit(numCells, numQuadPoints, FullMatrix<double>(dim*dim,dim*dim));
+    valid.assign(numCells*numQuadPoints, 0);
+    elastic.assign(numCells*numQuadPoints, 0);
+  }
+
+  //mark all entries invalid (e.g. when the converged history variables change)
+  void invalidate(){
+    std::fill(valid.begin(), valid.end(), 0);
+  }
+
+  //copy the stored results of the entry (cellID, q) to the point p of batch, if they are
+  //valid for the deformation gradient of that point. Returns false otherwise
+  bool lookup(const unsigned int cellID, const unsigned int q, constitutiveBatch<dim>& batch, const unsigned int p, const double tolerance, bool& isElastic) const{
+    const unsigned int k=index(cellID, q);
+    if (!valid[k]) return false;
+    const double* F_p=batch.F_ptr(p);
+    const double* F_stored=F(cellID, q);
+    for (unsigned int i=0; i<dim*dim; ++i){
+      if (std::abs(F_p[i]-F_stored[i])>tolerance) return false;
+    }
+    std::copy(P(cellID, q), P(cellID, q)+dim*dim, batch.P_ptr(p));
+    std::copy(T(cellID, q), T(cellID, q)+dim*dim, batch.T_ptr(p));
+    std::copy(dP_dF(cellID, q), dP_dF(cellID, q)+dim*dim*dim*dim, batch.dP_dF_ptr(p));
+    isElastic=elastic[k];
+    return true;
+  }
+
+  //store the deformation gradient and results of the point p of batch as entry (cellID, q)
+  void store(const unsigned int cellID, const unsigned int q, const constitutiveBatch<dim>& batch, const unsigned int p, const bool isElastic){
+    std::copy(batch.F_ptr(p), batch.F_ptr(p)+dim*dim, F(cellID, q));
+    std::copy(batch.P_ptr(p), batch.P_ptr(p)+dim*dim, P(cellID, q));
+    std::copy(batch.T_ptr(p), batch.T_ptr(p)+dim*dim, T(cellID, q));
+    std::copy(batch.dP_dF_ptr(p), batch.dP_dF_ptr(p)+dim*dim*dim*dim, dP_dF(cellID, q));
+    const unsigned int k=index(cellID, q);
+    elastic[k]=isElastic;
+    valid[k]=1;
+  }
+
+  std::size_t memory_consumption() const {
+    return F.memory_consumption()+P.memory_consumption()+T.memory_consumption()+dP_dF.memory_consumption()+2*valid.size();
+  }
+
+ private:
+  unsigned int index(const unsigned int cellID, const unsigned int q) const {return cellID*F.n_quadrature_points()+q;}
+  quadratureHistory F, P, T, dP_dF;
+  //one byte per entry (not std::vector<bool>), so that different cells can be written concurrently
+  std::vector<unsigned char> valid, elastic;
+};
+
+#endif
@@ -2,32 +2,86 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <set>
+#include <limits>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 template <int dim>
 class crystalOrientationsIO{
 public:
   crystalOrientationsIO();
+  ~crystalOrientationsIO();
   void loadOrientations(std::string _voxelFileName, 
 			unsigned int headerLines,
 			std::string _orientationFileName,
 			unsigned int _numPts[], 
 			double _stencil[]);
   void loadOrientationVector(std::string _eulerFileName);
+  void readLocalVoxels(const double _boxMin[], const double _boxMax[]);
+  void readLocalOrientations(const std::set<unsigned int>& _grainIDs);
   unsigned int getMaterialID(double _coords[]);
+  void writeVoxelFile(std::string _voxelFileName);
   void addToOutputOrientations(std::vector<double>& _orientationsInfo);
+  bool isOutputIncrement(unsigned int increment, bool lastIncrement);
   void writeOutputOrientations();
   std::map<unsigned int, std::vector<double> > eulerAngles;
   std::vector<std::vector<double> > outputOrientations;
 private:
-  std::map<double,std::map<double, std::map<double, unsigned int> > > inputVoxelData;
+  unsigned int lowerBoundIndex(unsigned int axis, double _coord);
+  unsigned int voxelIndex(unsigned int axis, double _coord);
+  //text files, read by readLocalVoxels and readLocalOrientations once the mesh is partitioned
+  std::string voxelFileName, eulerFileName;
+  unsigned int voxelHeaderLines;
+  //voxel grain IDs of the box voxelBoxMin..voxelBoxMin+voxelBoxSize-1, x-major as in
+  //the voxel data file, either read from a text file into voxelGrid or memory mapped
+  //from a binary file (the box is then the whole voxel grid)
+  const unsigned int* voxelData;
+  std::vector<unsigned int> voxelGrid;
+  unsigned int voxelBoxMin[3], voxelBoxSize[3];
+  void* mappedFile;
+  size_t mappedSize;
+  unsigned int numPts[3];
+  double stencil[3];
   ConditionalOStream  pcout;  
+  //"binary" or "text", and the output interval in increments
+  std::string outputFormat;
+  unsigned int outputStride;
 };
 
 //constructor
 template <int dim>
 crystalOrientationsIO<dim>::crystalOrientationsIO():
+  voxelHeaderLines(0),
+  voxelData(NULL),
+  mappedFile(NULL),
+  mappedSize(0),
   pcout (std::cout, Utilities::MPI::this_mpi_process(MPI_COMM_WORLD)==0)
-{}
+{
+#ifdef orientationsOutputFormat
+  outputFormat=orientationsOutputFormat;
+#else
+  outputFormat="text";
+#endif
+#ifdef orientationsOutputStride
+  outputStride=std::max(orientationsOutputStride, 1);
+#else
+  outputStride=1;
+#endif
+  if ((outputFormat!="binary") && (outputFormat!="text")){
+    pcout << "\nError: unknown orientationsOutputFormat " << outputFormat << ". Use \"binary\" or \"text\".\n\n";
+    exit (-1);
+  }
+}
+
+//destructor
+template <int dim>
+crystalOrientationsIO<dim>::~crystalOrientationsIO(){
+  if (mappedFile) munmap(mappedFile, mappedSize);
+}
 
 //addToOutputOrientations adds data to be written out to output oreintations file
 template <int dim>
@@ -35,7 +89,19 @@ void crystalOrientationsIO<dim>::addToOutputOrientations(std::vector<double>& _o
   outputOrientations.push_back(_orientationsInfo);
 }
 
-//writeOutputOreintations writes outputOrientations to file
+//orientations are written every outputStride increments and after the last increment
+//(lastIncrement: the total load factor has been reached, see ellipticBVP<dim>::isLastIncrement)
+template <int dim>
+bool crystalOrientationsIO<dim>::isOutputIncrement(unsigned int increment, bool lastIncrement){
+  return ((increment+1)%outputStride==0) || lastIncrement;
+}
+
+//writeOutputOreintations writes outputOrientations to file. All processors
+//write collectively into a single file (MPI-IO), each at the offset given by
+//the data of the processors before it (exclusive scan).
+//binary: orientationsOutput.bin, a header of two uint64 (number of rows and
+//columns) followed by the rows as native float64, in the order of the processors
+//text: orientationsOutput, one row per line in %8.2e
 template <int dim>
 void crystalOrientationsIO<dim>::writeOutputOrientations(){
   //check whether to write to file
@@ -52,44 +118,79 @@ void crystalOrientationsIO<dim>::writeOutputOrientations(){
 #else
   std::string dir("./");
 #endif
-  std::string fileName("orientationsOutputProc");
-  fileName += std::to_string(Utilities::MPI::this_mpi_process(MPI_COMM_WORLD));
-  std::ofstream file((dir+fileName).c_str());
-  char buffer[200];
-  if (file.is_open()){
+  //locally owned quadrature points
+  std::string data;
+  std::string fileName(dir+"orientationsOutput");
+  if (outputFormat=="binary"){
+    fileName+=".bin";
+    unsigned long long numRows=outputOrientations.size(), numColumns=0;
+    for (unsigned int i=0; i<outputOrientations.size(); ++i){
+      numColumns=std::max(numColumns, (unsigned long long) outputOrientations[i].size());
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &numRows, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &numColumns, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+    //all rows need the same number of columns. Checked collectively before the file is
+    //opened, so that all processors stop
+    int mismatchedRows=0;
+    for (unsigned int i=0; i<outputOrientations.size(); ++i){
+      if (outputOrientations[i].size()!=numColumns) mismatchedRows=1;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &mismatchedRows, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (mismatchedRows){
+      pcout << "\nError: all rows of the orientations output need the same number of columns\n\n";
+      exit(1);
+    }
+    if (Utilities::MPI::this_mpi_process(MPI_COMM_WORLD)==0){
+      data.append((const char*) &numRows, sizeof(numRows));
+      data.append((const char*) &numColumns, sizeof(numColumns));
+    }
+    data.reserve(data.size()+outputOrientations.size()*numColumns*sizeof(double));
+    for (std::vector<std::vector<double> >::iterator it = outputOrientations.begin() ; it != outputOrientations.end(); ++it){
+      data.append((const char*) &(*it)[0], numColumns*sizeof(double));
+    }
+  }
+  else{
+    char buffer[200];
     for (std::vector<std::vector<double> >::iterator it = outputOrientations.begin() ; it != outputOrientations.end(); ++it){
       for (std::vector<double>::iterator it2 = it->begin() ; it2 != it->end(); ++it2){
 	sprintf(buffer, "%8.2e ",*it2);
-	file << buffer;
+	data+=buffer;
       }
-      file << std::endl;
+      data+="\n";
     }
-    file.close();
   }
-  else {
+
+  unsigned long long localSize=data.size(), offset=0;
+  MPI_Exscan(&localSize, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  if (Utilities::MPI::this_mpi_process(MPI_COMM_WORLD)==0) offset=0;
+  MPI_File file;
+  int ierr=MPI_File_open(MPI_COMM_WORLD, const_cast<char*>(fileName.c_str()), MPI_MODE_CREATE|MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+  if (ierr!=MPI_SUCCESS){
     pcout << "Unable to open file for writing orientations\n";
     exit(1);
   }
-  
-  //join files from all processors into a single file on processor 0 
-  //and delete individual processor files 
-  MPI_Barrier(MPI_COMM_WORLD);
-  if (Utilities::MPI::this_mpi_process(MPI_COMM_WORLD)==0){
-     std::string fileName2("orientationsOutput");
-      std::ofstream file2((dir+fileName2).c_str());
-      for (unsigned int proc=0; proc<Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD); proc++){
-	std::string fileName3("orientationsOutputProc");
-	fileName3 += std::to_string(proc);
-	std::ofstream file3((dir+fileName3).c_str(), std::ofstream::in);
-	file2 << file3.rdbuf();
-	//delete file from processor proc
-	remove((dir+fileName3).c_str());
-      }
-      file2.close();
+  MPI_File_set_size(file, 0);
+  //the count of MPI_File_write_at_all is an int, the data is written in chunks of 1 GiB.
+  //Every processor takes part in every collective write, with an empty chunk if done
+  const unsigned long long chunkSize=1ull<<30;
+  unsigned long long numChunks=(localSize+chunkSize-1)/chunkSize;
+  MPI_Allreduce(MPI_IN_PLACE, &numChunks, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+  int failedWrite=0;
+  for (unsigned long long i=0; i<numChunks; ++i){
+    const unsigned long long begin=std::min(i*chunkSize, localSize);
+    const int count=(int) std::min(chunkSize, localSize-begin);
+    if (MPI_File_write_at_all(file, (MPI_Offset) (offset+begin), const_cast<char*>(data.c_str())+begin, count, MPI_CHAR, MPI_STATUS_IGNORE)!=MPI_SUCCESS) failedWrite=1;
+  }
+  MPI_File_close(&file);
+  MPI_Allreduce(MPI_IN_PLACE, &failedWrite, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  if (failedWrite){
+    pcout << "Unable to write orientations\n";
+    exit(1);
   }
 }
 
-//loadOrientationVector reads the orientation euler angles file   
+//loadOrientationVector sets the orientation euler angles file. The file is read
+//by readLocalOrientations, for the grains referenced on this processor only
 template <int dim>
 void crystalOrientationsIO<dim>::loadOrientationVector(std::string _eulerFileName){
  //check if dim==3
@@ -97,33 +198,34 @@ void crystalOrientationsIO<dim>::loadOrientationVector(std::string _eulerFileNam
     pcout << "loadOrientationVector only implemented for dim==3\n";
     exit(1);
   }
+  eulerFileName=_eulerFileName;
+}
 
+//readLocalOrientations reads the euler angles (and the phase, with multiplePhase)
+//of the given grains from the orientation euler angles file
+template <int dim>
+void crystalOrientationsIO<dim>::readLocalOrientations(const std::set<unsigned int>& _grainIDs){
+  if (eulerFileName.empty()) return;
   //open data file
-  std::ifstream eulerDataFile(_eulerFileName.c_str());
+  std::ifstream eulerDataFile(eulerFileName.c_str());
   //read data 
   std::string line; 
-  double value; 
-  unsigned int id;
+  unsigned int numValues=3;
+#ifdef multiplePhase
+  if(multiplePhase) numValues=4;
+#endif
   if (eulerDataFile.is_open()){
     pcout << "reading orientation euler angles file\n";
     //skip header lines
     for (unsigned int i=0; i<1; i++) std::getline (eulerDataFile,line);
-    //read data
+    //read data of the referenced grains
     while (getline (eulerDataFile,line)){
       std::stringstream ss(line);
       unsigned int id; 
       ss >> id; 
-      //double temp;
-      //ss >> temp;
-      eulerAngles[id]=std::vector<double>(3);
-      ss >> eulerAngles[id][0];
-      ss >> eulerAngles[id][1];
-      ss >> eulerAngles[id][2];
-#ifdef multiplePhase
-        if(multiplePhase)
-        ss >> eulerAngles[id][3];
-#endif
-      //pcout << id << " " << eulerAngles[id][0] << " " << eulerAngles[id][1] << " " << eulerAngles[id][2] << std::endl;
+      if (_grainIDs.count(id)==0) continue;
+      eulerAngles[id]=std::vector<double>(numValues);
+      for (unsigned int i=0; i<numValues; i++) ss >> eulerAngles[id][i];
     }
   }
   else{
@@ -132,7 +234,16 @@ void crystalOrientationsIO<dim>::loadOrientationVector(std::string _eulerFileNam
   }
 }
 
-//loadOrientations reads the voxel data file and orientations file   
+//binary voxel file: the 8 byte voxelFileMagic, numPts as three uint32 and the
+//grain IDs as uint32 in the order of the text voxel data file
+static const char voxelFileMagic[8]={'V','O','X','E','L','U','3','2'};
+static const size_t voxelFileHeaderSize=sizeof(voxelFileMagic)+3*sizeof(unsigned int);
+
+//loadOrientations sets the voxel data file, either the text file (headerLines
+//header lines, then one line of numPts[2] grain IDs for every x and y) or the
+//binary file written by writeVoxelFile. The binary file is memory mapped, so
+//each processor only reads the pages of the voxels it looks up. The text file is
+//read by readLocalVoxels, once the box of the locally owned cells is known
 template <int dim>
 void crystalOrientationsIO<dim>::loadOrientations(std::string _voxelFileName, 
 						  unsigned int headerLines,
@@ -144,58 +255,159 @@ void crystalOrientationsIO<dim>::loadOrientations(std::string _voxelFileName,
     pcout << "voxelDataFile read only implemented for dim==3\n";
     exit(1);
   }
+  for (unsigned int i=0; i<3; i++) {numPts[i]=_numPts[i]; stencil[i]=_stencil[i];}
+  const size_t numVoxels=(size_t) numPts[0]*numPts[1]*numPts[2];
+
+  //binary voxel file
+  int fd=open(_voxelFileName.c_str(), O_RDONLY);
+  if (fd<0) {
+    pcout << "Unable to open file voxelDataFile\n"; 
+    exit(1);
+  }
+  char magic[sizeof(voxelFileMagic)];
+  if ((read(fd, magic, sizeof(magic))==(ssize_t) sizeof(magic)) && (memcmp(magic, voxelFileMagic, sizeof(magic))==0)){
+    pcout << "mapping binary voxel data file\n";
+    unsigned int fileNumPts[3];
+    struct stat fileStat;
+    if ((read(fd, fileNumPts, sizeof(fileNumPts))!=(ssize_t) sizeof(fileNumPts)) || (fstat(fd, &fileStat)!=0)){
+      pcout << "Unable to read voxelDataFile\n";
+      exit(1);
+    }
+    if ((fileNumPts[0]!=numPts[0]) || (fileNumPts[1]!=numPts[1]) || (fileNumPts[2]!=numPts[2]) || ((size_t) fileStat.st_size!=voxelFileHeaderSize+numVoxels*sizeof(unsigned int))){
+      pcout << "\nError: voxelDataFile has " << fileNumPts[0] << "x" << fileNumPts[1] << "x" << fileNumPts[2] << " voxels, numPts is " << numPts[0] << "x" << numPts[1] << "x" << numPts[2] << "\n\n";
+      exit(-1);
+    }
+    mappedSize=fileStat.st_size;
+    mappedFile=mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mappedFile==MAP_FAILED) {
+      mappedFile=NULL;
+      pcout << "Unable to map voxelDataFile\n";
+      exit(1);
+    }
+    //the lookups of the cell centers are scattered over the file
+    madvise(mappedFile, mappedSize, MADV_RANDOM);
+    voxelData=(const unsigned int*) ((const char*) mappedFile+voxelFileHeaderSize);
+    for (unsigned int i=0; i<3; i++) {voxelBoxMin[i]=0; voxelBoxSize[i]=numPts[i];}
+    return;
+  }
+  close(fd);
+
+  //text voxel file
+  voxelFileName=_voxelFileName;
+  voxelHeaderLines=headerLines;
+}
+
+//readLocalVoxels reads the voxels of a text voxel data file that the points in
+//the box _boxMin.._boxMax are mapped to. The lines of the file outside the box
+//are skipped without parsing them, and the file is only read up to the last x
+//slice of the box. An empty box (_boxMin>_boxMax) reads a single voxel
+template <int dim>
+void crystalOrientationsIO<dim>::readLocalVoxels(const double _boxMin[], const double _boxMax[]){
+  if ((voxelData!=NULL) || voxelFileName.empty()) return;
+  //voxel index range of the box (getMaterialID is monotone in the coordinates)
+  unsigned int lo[3], hi[3];
+  for (unsigned int i=0; i<3; i++) {
+    lo[i]=0; hi[i]=0;
+    if (_boxMin[i]<=_boxMax[i]) {lo[i]=voxelIndex(i, _boxMin[i]); hi[i]=voxelIndex(i, _boxMax[i]);}
+  }
+  //the binary voxel file is written from all voxels on processor 0
+#ifdef convertGrainIDFile
+  const bool convert=convertGrainIDFile && (Utilities::MPI::this_mpi_process(MPI_COMM_WORLD)==0);
+  if (convert) {
+    for (unsigned int i=0; i<3; i++) {lo[i]=0; hi[i]=numPts[i]-1;}
+  }
+#endif
+  for (unsigned int i=0; i<3; i++) {voxelBoxMin[i]=lo[i]; voxelBoxSize[i]=hi[i]-lo[i]+1;}
 
   //open voxel data file
-  std::ifstream voxelDataFile(_voxelFileName.c_str());
-  //read voxel data 
+  std::ifstream voxelDataFile(voxelFileName.c_str());
   std::string line; 
-  double value; 
-  unsigned int id;
   if (voxelDataFile.is_open()){
     pcout << "reading voxel data file\n";
     //skip header lines
-    for (unsigned int i=0; i<headerLines; i++) std::getline (voxelDataFile,line);
+    for (unsigned int i=0; i<voxelHeaderLines; i++) std::getline (voxelDataFile,line);
     //read data
-    for (unsigned int x=0; x<_numPts[0]; x++){
-      double xVal=x*_stencil[0];
-      if (inputVoxelData.count(xVal)==0) inputVoxelData[xVal]=std::map<double, std::map<double, unsigned int> >();
-      for (unsigned int y=0; y<_numPts[1]; y++){
-	double yVal=y*_stencil[1];
-	if (inputVoxelData[xVal].count(yVal)==0) inputVoxelData[xVal][yVal]=std::map<double, unsigned int>();
+    voxelGrid.assign((size_t) voxelBoxSize[0]*voxelBoxSize[1]*voxelBoxSize[2], 0);
+    for (unsigned int x=0; x<=hi[0]; x++){
+      for (unsigned int y=0; y<numPts[1]; y++){
+	if ((x<lo[0]) || (y<lo[1]) || (y>hi[1])){
+	  voxelDataFile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+	  continue;
+	}
 	std::getline (voxelDataFile,line);
-	std::stringstream ss(line);
-	for (unsigned int z=0; z<_numPts[2]; z++){
-	  double zVal=z*_stencil[2];
-	  ss >> inputVoxelData[xVal][yVal][zVal];
-	  //pcout <<  inputVoxelData[xVal][yVal][zVal] << " ";
+	const char* entry=line.c_str();
+	unsigned int* id=&voxelGrid[((size_t) (x-lo[0])*voxelBoxSize[1]+(y-lo[1]))*voxelBoxSize[2]];
+	for (unsigned int z=0; z<=hi[2]; z++){
+	  char* end;
+	  const unsigned int value=strtoul(entry, &end, 10);
+	  entry=end;
+	  if (z>=lo[2]) *id++=value;
 	}
-	//pcout << "\n";
       }
     }
+    voxelData=&voxelGrid[0];
   }
   else {
     pcout << "Unable to open file voxelDataFile\n"; 
     exit(1);
   }
+#ifdef convertGrainIDFile
+  if (convert) writeVoxelFile(voxelFileName+".bin");
+#endif
+}
+
+//write the voxel grain IDs to a binary voxel file (processor 0, which needs all
+//voxels), which can replace the text file as grainIDFile in the following runs
+template <int dim>
+void crystalOrientationsIO<dim>::writeVoxelFile(std::string _voxelFileName){
+  if (Utilities::MPI::this_mpi_process(MPI_COMM_WORLD)!=0) return;
+  AssertThrow((voxelData!=NULL) && (voxelBoxSize[0]==numPts[0]) && (voxelBoxSize[1]==numPts[1]) && (voxelBoxSize[2]==numPts[2]),
+	      ExcMessage("writeVoxelFile needs all voxels of the voxel data file"));
+  std::ofstream file(_voxelFileName.c_str(), std::ios::binary);
+  file.write(voxelFileMagic, sizeof(voxelFileMagic));
+  file.write((const char*) numPts, sizeof(numPts));
+  file.write((const char*) voxelData, (size_t) numPts[0]*numPts[1]*numPts[2]*sizeof(unsigned int));
+  if (!file) {
+    pcout << "Unable to write binary voxel data file\n";
+    exit(1);
+  }
+  pcout << "binary voxel data file written to: " << _voxelFileName << "\n";
+}
+
+//first voxel index i along the axis with i*stencil>=_coord (numPts if none).
+//The guess from the division is corrected against the voxel coordinates i*stencil
+template <int dim>
+unsigned int crystalOrientationsIO<dim>::lowerBoundIndex(unsigned int axis, double _coord){
+  const unsigned int n=numPts[axis];
+  const double guess=std::ceil(_coord/stencil[axis]);
+  unsigned int i=(guess<=0.0) ? 0 : ((guess>=n) ? n : (unsigned int) guess);
+  while ((i>0) && ((i-1)*stencil[axis]>=_coord)) i--;
+  while ((i<n) && (i*stencil[axis]<_coord)) i++;
+  return i;
+}
+
+//voxel index along the axis closest to the coordinate. As the previous lookup in
+//the nested voxel maps: the last voxel below the point in x and z, and the first
+//voxel at or above the point in y
+template <int dim>
+unsigned int crystalOrientationsIO<dim>::voxelIndex(unsigned int axis, double _coord){
+  const unsigned int i=lowerBoundIndex(axis, _coord);
+  if (axis==1) return std::min(i, numPts[1]-1);
+  return (i>0) ? i-1 : 0;
 }
 
 //return materialID closest to given (x,y,z)
 template <int dim>
 unsigned int crystalOrientationsIO<dim>::getMaterialID(double _coords[]){
-  if (inputVoxelData.size()==0){
-    pcout << "inputVoxelData not initialized\n";
+  if (voxelData==NULL){
+    pcout << "voxel data not initialized\n";
     exit(1);
   }
-
-  //find nearest point
-  //iterator to nearest x slice
-  std::map<double,std::map<double, std::map<double, unsigned int> > >::iterator itx=inputVoxelData.lower_bound(_coords[0]); 
-  if(itx != inputVoxelData.end()) --itx;
-  //iterator to nearest y slice
-  std::map<double, std::map<double, unsigned int> >::iterator ity=itx->second.lower_bound(_coords[1]); 
-  if(ity == itx->second.end()) --ity;
-  //iterator to nearest z slice
-  std::map<double, unsigned int>::iterator itz=ity->second.lower_bound(_coords[2]); 
-  if(itz != ity->second.end()) --itz;
-  return itz->second; 
+  unsigned int index[3];
+  for (unsigned int i=0; i<3; i++){
+    index[i]=voxelIndex(i, _coords[i])-voxelBoxMin[i];
+    AssertThrow(index[i]<voxelBoxSize[i], ExcMessage("point outside of the voxels read by this processor"));
+  }
+  return voxelData[((size_t) index[0]*voxelBoxSize[1]+index[1])*voxelBoxSize[2]+index[2]];
 }
@@ -0,0 +1,135 @@
+//vectorized elemental residual and stiffness kernel for the crystal plasticity models
+
+#ifndef ELEMENTALSTIFFNESS_H
+#define ELEMENTALSTIFFNESS_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//Evaluates the elemental residual R_{d} -= N_{d,j}*P_{ij}*JxW and stiffness
+//K_{d1d2} += N_{d1,k}*C_{ik,jl}*N_{d2,l}*JxW of a cell, where i and j are the
+//vector components of the dofs. The tangent C=dP/dF is passed in the compact
+//(dim*dim)x(dim*dim) layout, row dim*i+k and column dim*j+l.
+//
+//The quadrature points are processed VectorizedArray<double>::n_array_elements
+//at a time (one SIMD lane per quadrature point, AVX: 4, AVX-512: 8, depending on
+//the instruction set deal.II was configured with). Per cell, the shape gradients
+//are gathered once into a table, and the stresses and tangents of the quadrature
+//points are collected with setQuadPointValues. assemble then builds the
+//stiffness in two blocked steps, W=B^T*C*JxW (dofs_per_cell x dim*dim) and
+//K+=W*B, where only the dim nonzero entries of each column of the B-matrix are
+//visited, and sums the lanes at the end. Unused lanes of the last batch have
+//zero JxW, stress and tangent and do not contribute.
+template <int dim>
+class elementalStiffness
+{
+ public:
+  elementalStiffness(): dofs_per_cell(0), n_q_points(0), n_batches(0) {}
+
+  //set up the dof to component map and the work arrays of the finite element and quadrature
+  void reinit(const FiniteElement<dim>& fe, const unsigned int _n_q_points){
+    dofs_per_cell=fe.dofs_per_cell;
+    n_q_points=_n_q_points;
+    n_batches=(n_q_points+lanes-1)/lanes;
+    component.resize(dofs_per_cell);
+    for (unsigned int d=0; d<dofs_per_cell; ++d){
+      component[d]=fe.system_to_component_index(d).first;
+    }
+    shapeGrad.resize(n_batches*dofs_per_cell*dim);
+    JxW.resize(n_batches);
+    stress.resize(n_batches*dim*dim);
+    tangent.resize(n_batches*dim*dim*dim*dim);
+    W.resize(dofs_per_cell*dim*dim);
+    Kv.resize(dofs_per_cell*dofs_per_cell);
+    Rv.resize(dofs_per_cell);
+    //the unused lanes of the last batch keep these zeros
+    for (unsigned int i=0; i<stress.size(); ++i) stress[i]=0.0;
+    for (unsigned int i=0; i<tangent.size(); ++i) tangent[i]=0.0;
+  }
+
+  //gather the shape gradients and JxW of the cell fe_values was reinit'ed on
+  void reinitCell(const FEValues<dim>& fe_values){
+    if (dofs_per_cell!=fe_values.get_fe().dofs_per_cell || n_q_points!=fe_values.n_quadrature_points){
+      reinit(fe_values.get_fe(), fe_values.n_quadrature_points);
+    }
+    for (unsigned int b=0; b<n_batches; ++b){
+      for (unsigned int v=0; v<lanes; ++v){
+	const unsigned int q=b*lanes+v;
+	JxW[b][v]=(q<n_q_points) ? fe_values.JxW(q) : 0.0;
+	for (unsigned int d=0; d<dofs_per_cell; ++d){
+	  for (unsigned int k=0; k<dim; ++k){
+	    shapeGrad[(b*dofs_per_cell+d)*dim+k][v]=(q<n_q_points) ? fe_values.shape_grad(d, q)[k] : 0.0;
+	  }
+	}
+      }
+    }
+  }
+
+  //store the stress P and the compact tangent C of the quadrature point q
+  void setQuadPointValues(const unsigned int q, const FullMatrix<double>& P, const FullMatrix<double>& C){
+    AssertIndexRange(q, n_q_points);
+    AssertDimension(C.m(), dim*dim); AssertDimension(C.n(), dim*dim);
+    const unsigned int b=q/lanes, v=q%lanes;
+    for (unsigned int i=0; i<dim; ++i){
+      for (unsigned int j=0; j<dim; ++j) stress[b*dim*dim+i*dim+j][v]=P(i,j);
+    }
+    for (unsigned int ik=0; ik<dim*dim; ++ik){
+      for (unsigned int jl=0; jl<dim*dim; ++jl) tangent[(b*dim*dim+ik)*dim*dim+jl][v]=C(ik,jl);
+    }
+  }
+
+  //K+=B^T*C*B*JxW and R-=B^T*P*JxW summed over the quadrature points of the cell
+  void assemble(FullMatrix<double>& K, Vector<double>& R){
+    for (unsigned int i=0; i<Kv.size(); ++i) Kv[i]=0.0;
+    for (unsigned int i=0; i<Rv.size(); ++i) Rv[i]=0.0;
+    for (unsigned int b=0; b<n_batches; ++b){
+      const VectorizedArray<double>* grad=&shapeGrad[b*dofs_per_cell*dim];
+      const VectorizedArray<double>* P=&stress[b*dim*dim];
+      const VectorizedArray<double>* C=&tangent[b*dim*dim*dim*dim];
+      //residual, and W=B^T*C*JxW where row d1 only sees the rows dim*i..dim*i+dim-1 of C
+      for (unsigned int d1=0; d1<dofs_per_cell; ++d1){
+	const unsigned int i=component[d1];
+	VectorizedArray<double>* w=&W[d1*dim*dim];
+	VectorizedArray<double> r;
+	r=0.0;
+	for (unsigned int jl=0; jl<dim*dim; ++jl) w[jl]=0.0;
+	for (unsigned int k=0; k<dim; ++k){
+	  const VectorizedArray<double> g=grad[d1*dim+k]*JxW[b];
+	  r+=g*P[i*dim+k];
+	  const VectorizedArray<double>* c=&C[(dim*i+k)*dim*dim];
+	  for (unsigned int jl=0; jl<dim*dim; ++jl) w[jl]+=g*c[jl];
+	}
+	Rv[d1]-=r;
+      }
+      //K+=W*B, column d2 only sees the entries dim*j..dim*j+dim-1 of the rows of W
+      for (unsigned int d1=0; d1<dofs_per_cell; ++d1){
+	const VectorizedArray<double>* w=&W[d1*dim*dim];
+	for (unsigned int d2=0; d2<dofs_per_cell; ++d2){
+	  const VectorizedArray<double>* wj=&w[dim*component[d2]];
+	  const VectorizedArray<double>* g=&grad[d2*dim];
+	  VectorizedArray<double> sum=wj[0]*g[0];
+	  for (unsigned int l=1; l<dim; ++l) sum+=wj[l]*g[l];
+	  Kv[d1*dofs_per_cell+d2]+=sum;
+	}
+      }
+    }
+    //sum the lanes
+    for (unsigned int d1=0; d1<dofs_per_cell; ++d1){
+      for (unsigned int v=0; v<lanes; ++v) R(d1)+=Rv[d1][v];
+      for (unsigned int d2=0; d2<dofs_per_cell; ++d2){
+	double sum=0.0;
+	for (unsigned int v=0; v<lanes; ++v) sum+=Kv[d1*dofs_per_cell+d2][v];
+	K(d1,d2)+=sum;
+      }
+    }
+  }
+
+ private:
+  static const unsigned int lanes=VectorizedArray<double>::n_array_elements;
+  unsigned int dofs_per_cell, n_q_points, n_batches;
+  std::vector<unsigned int> component;
+  //per batch of quadrature points: shape gradients (dof, k), JxW, P (i,j) and C (ik,jl)
+  AlignedVector<VectorizedArray<double> > shapeGrad, JxW, stress, tangent;
+  AlignedVector<VectorizedArray<double> > W, Kv, Rv;
+};
+
+#endif
@@ -0,0 +1,129 @@
+//contiguous storage of quadrature point history variables
+
+#ifndef QUADRATUREHISTORY_H
+#define QUADRATUREHISTORY_H
+//this source file is temporarily treated as a header file (hence
+//#ifndef's) till library packaging scheme is finalized
+
+//Stores one matrix (or vector) valued history variable for all quadrature
+//points of all locally owned cells in a single aligned array, indexed by
+//(cellID, quadrature point, component). Matrices are stored row-wise.
+class quadratureHistory
+{
+ public:
+  quadratureHistory(): numCells(0), numQuadPoints(0), numRows(0), numCols(0) {}
+
+  //allocate numCells*numQuadPoints entries, each initialized to initValue
+  void reinit(const unsigned int _numCells, const unsigned int _numQuadPoints, const FullMatrix<double>& initValue){
+    allocate(_numCells, _numQuadPoints, initValue.m(), initValue.n());
+    for (unsigned int k=0; k<numCells*numQuadPoints; k++){
+      double* entry=&data[k*n_components()];
+      for (unsigned int i=0; i<numRows; i++){
+	for (unsigned int j=0; j<numCols; j++){
+	  entry[i*numCols+j]=initValue(i,j);
+	}
+      }
+    }
+  }
+  void reinit(const unsigned int _numCells, const unsigned int _numQuadPoints, const Vector<double>& initValue){
+    allocate(_numCells, _numQuadPoints, initValue.size(), 1);
+    for (unsigned int k=0; k<numCells*numQuadPoints; k++){
+      std::copy(initValue.begin(), initValue.end(), &data[k*n_components()]);
+    }
+  }
+
+  //pointer to the components of the entry (cellID, q)
+  double* operator()(const unsigned int cellID, const unsigned int q){
+    AssertIndexRange(cellID, numCells); AssertIndexRange(q, numQuadPoints);
+    return &data[(cellID*numQuadPoints+q)*n_components()];
+  }
+  const double* operator()(const unsigned int cellID, const unsigned int q) const{
+    AssertIndexRange(cellID, numCells); AssertIndexRange(q, numQuadPoints);
+    return &data[(cellID*numQuadPoints+q)*n_components()];
+  }
+
+  //copy the entry (cellID, q) to/from a matrix or vector of matching size
+  void get(const unsigned int cellID, const unsigned int q, FullMatrix<double>& A) const{
+    AssertDimension(A.m(), numRows); AssertDimension(A.n(), numCols);
+    const double* entry=(*this)(cellID, q);
+    for (unsigned int i=0; i<numRows; i++){
+      for (unsigned int j=0; j<numCols; j++){
+	A(i,j)=entry[i*numCols+j];
+      }
+    }
+  }
+  void get(const unsigned int cellID, const unsigned int q, Vector<double>& v) const{
+    AssertDimension(v.size(), n_components());
+    const double* entry=(*this)(cellID, q);
+    std::copy(entry, entry+n_components(), v.begin());
+  }
+  void set(const unsigned int cellID, const unsigned int q, const FullMatrix<double>& A){
+    AssertDimension(A.m(), numRows); AssertDimension(A.n(), numCols);
+    double* entry=(*this)(cellID, q);
+    for (unsigned int i=0; i<numRows; i++){
+      for (unsigned int j=0; j<numCols; j++){
+	entry[i*numCols+j]=A(i,j);
+      }
+    }
+  }
+  void set(const unsigned int cellID, const unsigned int q, const Vector<double>& v){
+    AssertDimension(v.size(), n_components());
+    std::copy(v.begin(), v.end(), (*this)(cellID, q));
+  }
+
+  //exchange the contents with another history of the same layout (e.g. iter and conv)
+  void swap(quadratureHistory& other){
+    data.swap(other.data);
+    std::swap(numCells, other.numCells);
+    std::swap(numQuadPoints, other.numQuadPoints);
+    std::swap(numRows, other.numRows);
+    std::swap(numCols, other.numCols);
+  }
+
+  //binary output and input of the layout and values (checkpoints). read expects the same layout
+  void write(std::ostream& out) const{
+    const unsigned int layout[4]={numCells, numQuadPoints, numRows, numCols};
+    out.write(reinterpret_cast<const char*>(layout), sizeof(layout));
+    out.write(reinterpret_cast<const char*>(data.begin()), data.size()*sizeof(double));
+  }
+  void read(std::istream& in){
+    unsigned int layout[4];
+    in.read(reinterpret_cast<char*>(layout), sizeof(layout));
+    AssertThrow(in && (layout[0]==numCells) && (layout[1]==numQuadPoints) && (layout[2]==numRows) && (layout[3]==numCols),
+		ExcMessage("checkpoint data does not match the current mesh and partition"));
+    in.read(reinterpret_cast<char*>(data.begin()), data.size()*sizeof(double));
+  }
+
+  //reallocate for numCells cells with the same layout. The values are not kept (see unpack)
+  void resizeCells(const unsigned int _numCells){
+    allocate(_numCells, numQuadPoints, numRows, numCols);
+  }
+
+  //copy the entry (cellID, q) to/from a buffer (history transferred to a new mesh, see
+  //ellipticBVP<dim>::updateMesh). Return the position behind the copied values
+  double* pack(const unsigned int cellID, const unsigned int q, double* buffer) const{
+    const double* entry=(*this)(cellID, q);
+    std::copy(entry, entry+n_components(), buffer);
+    return buffer+n_components();
+  }
+  const double* unpack(const unsigned int cellID, const unsigned int q, const double* buffer){
+    std::copy(buffer, buffer+n_components(), (*this)(cellID, q));
+    return buffer+n_components();
+  }
+
+  unsigned int n_cells() const {return numCells;}
+  unsigned int n_quadrature_points() const {return numQuadPoints;}
+  unsigned int n_components() const {return numRows*numCols;}
+  std::size_t memory_consumption() const {return data.memory_consumption();}
+
+ private:
+  void allocate(const unsigned int _numCells, const unsigned int _numQuadPoints, const unsigned int _numRows, const unsigned int _numCols){
+    numCells=_numCells; numQuadPoints=_numQuadPoints;
+    numRows=_numRows; numCols=_numCols;
+    data.resize(numCells*numQuadPoints*n_components());
+  }
+  AlignedVector<double> data;
+  unsigned int numCells, numQuadPoints, numRows, numCols;
+};
+
+#endif
@@ -0,0 +1,146 @@
+//unit tests of the matrix exponential of the crystal plasticity models
+//
+//The methods in matrixOperations.cc only depend on their arguments. They are
+//compiled here into a stub of the crystalPlasticity class of every model, and
+//matrixExponential (scaling and squaring) is compared with the Taylor series
+//it replaced, for small, moderate and large norms of the argument. In addition
+//exp(0)=I, exp(A)exp(-A)=I and det(exp(A))=exp(tr A) are checked.
+//
+//Build and run with the CMakeLists.txt of this directory against deal.II
+//(cmake -DDEAL_II_DIR=... . && make && ./test). The program returns 1 if a
+//check fails. So far these tests have only been run with a minimal stand-in
+//for the deal.II Vector and FullMatrix, not against the deal.II library.
+#include <deal.II/base/logstream.h>
+#include <deal.II/lac/vector.h>
+#include <deal.II/lac/full_matrix.h>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+
+using namespace dealii;
+
+#define MATRIX_OPERATIONS_STUB						\
+  template <int dim>							\
+  class crystalPlasticity						\
+  {									\
+  public:								\
+    Vector<double> vecform(const FullMatrix<double> &A);		\
+    void vecform(const FullMatrix<double> &A, Vector<double> &Av);	\
+    void matform(FullMatrix<double> &A, const Vector<double> &Av);	\
+    void right(FullMatrix<double> &Aright,FullMatrix<double> elm);	\
+    void symmf(FullMatrix<double> &A,FullMatrix<double> elm);		\
+    void left(FullMatrix<double> &Aleft,FullMatrix<double> elm);	\
+    void ElasticProd(FullMatrix<double> &stress,FullMatrix<double> elm, FullMatrix<double> ElasticityTensor); \
+    void tracev(FullMatrix<double> &Atrace, FullMatrix<double> elm, FullMatrix<double> B); \
+    void matrixExponential(const FullMatrix<double> &A, FullMatrix<double> &expA); \
+  };
+
+namespace fcc{
+  MATRIX_OPERATIONS_STUB
+#include "../../src/materialModels/crystalPlasticity/fcc/matrixOperations.cc"
+}
+namespace bcc{
+  MATRIX_OPERATIONS_STUB
+#include "../../src/materialModels/crystalPlasticity/bcc/matrixOperations.cc"
+}
+namespace hcp{
+  MATRIX_OPERATIONS_STUB
+#include "../../src/materialModels/crystalPlasticity/hcp/matrixOperations.cc"
+}
+namespace dualPhase{
+  MATRIX_OPERATIONS_STUB
+#include "../../src/materialModels/crystalPlasticity/dualPhase/matrixOperations.cc"
+}
+
+const unsigned int dim=3;
+
+//former implementation: Taylor series summed until the last term is below 1e-15
+FullMatrix<double> seriesExponential(FullMatrix<double> A) {
+  FullMatrix<double> matExp(dim,dim),temp(dim,dim),temp2(dim,dim);
+  matExp=IdentityMatrix(dim);
+  temp=IdentityMatrix(dim);
+  double count=1;
+  while(temp.frobenius_norm()>1e-15){
+    temp.mmult(temp2,A);
+    temp2.equ(1/count,temp2);
+    temp.equ(1.0,temp2);
+    matExp.add(1.0,temp);
+    count=count+1.0;
+  }
+  return matExp;
+}
+
+//random matrix with entries in [-1,1] scaled to the Frobenius norm "norm"
+FullMatrix<double> randomMatrix(const double norm){
+  FullMatrix<double> A(dim,dim);
+  for (unsigned int i=0; i<dim; i++){
+    for (unsigned int j=0; j<dim; j++) A(i,j)=2.0*std::rand()/RAND_MAX-1.0;
+  }
+  A*=norm/A.frobenius_norm();
+  return A;
+}
+
+unsigned int numFailed=0;
+
+void check(const bool passed, const std::string& model, const std::string& test, const double norm, const double error){
+  if (!passed){
+    std::cout << model << ": " << test << " failed for |A|=" << norm << ", error " << error << "\n";
+    numFailed++;
+  }
+}
+
+template <class model>
+void testMatrixExponential(const std::string& name){
+  model cp;
+  FullMatrix<double> expA(dim,dim), expMinusA(dim,dim), product(dim,dim), A(dim,dim), I(dim,dim);
+  I=IdentityMatrix(dim);
+
+  //exp(0)=I
+  cp.matrixExponential(A, expA);
+  expA.add(-1.0, I);
+  check(expA.frobenius_norm()==0.0, name, "exp(0)=I", 0.0, expA.frobenius_norm());
+
+  //small (typical del_FP), moderate and large norms, with the tolerances of the comparison
+  //with the series and of the determinant (cancellation in the cofactors for large norms)
+  const double norms[]={1.0e-10, 1.0e-6, 1.0e-3, 1.0e-1, 0.5, 1.0, 2.0, 5.0, 10.0};
+  const double tolerances[]={1.0e-14, 1.0e-14, 1.0e-14, 1.0e-13, 1.0e-13, 1.0e-13, 1.0e-12, 1.0e-11, 1.0e-9};
+  const double detTolerances[]={1.0e-14, 1.0e-14, 1.0e-14, 1.0e-14, 1.0e-14, 1.0e-13, 1.0e-13, 1.0e-12, 1.0e-6};
+  for (unsigned int n=0; n<sizeof(norms)/sizeof(double); n++){
+    for (unsigned int sample=0; sample<20; sample++){
+      A=randomMatrix(norms[n]);
+      cp.matrixExponential(A, expA);
+
+      //comparison with the series
+      FullMatrix<double> diff=seriesExponential(A);
+      const double expNorm=diff.frobenius_norm();
+      diff.add(-1.0, expA);
+      check(diff.frobenius_norm()<=tolerances[n]*expNorm, name, "comparison with the series", norms[n], diff.frobenius_norm()/expNorm);
+
+      //det(exp(A))=exp(tr A)
+      const double detError=std::abs(expA.determinant()/std::exp(A.trace())-1.0);
+      check(detError<=detTolerances[n], name, "det(exp(A))=exp(tr A)", norms[n], detError);
+
+      //exp(A)exp(-A)=I
+      A*=-1.0;
+      cp.matrixExponential(A, expMinusA);
+      expA.mmult(product, expMinusA);
+      product.add(-1.0, I);
+      check(product.frobenius_norm()<=tolerances[n]*expNorm*expMinusA.frobenius_norm(), name, "exp(A)exp(-A)=I", norms[n], product.frobenius_norm());
+    }
+  }
+}
+
+int main(){
+  std::srand(1);
+  testMatrixExponential<fcc::crystalPlasticity<dim> >("fcc");
+  testMatrixExponential<bcc::crystalPlasticity<dim> >("bcc");
+  testMatrixExponential<hcp::crystalPlasticity<dim> >("hcp");
+  testMatrixExponential<dualPhase::crystalPlasticity<dim> >("dualPhase");
+  if (numFailed>0){
+    std::cout << numFailed << " checks failed\n";
+    return 1;
+  }
+  std::cout << "all checks passed\n";
+  return 0;
+}